@@ -0,0 +1,210 @@
+#include "agent.hpp"
+#include <cmath>
+#include <unistd.h>
+
+namespace agent {
+
+namespace {
+constexpr keys::Key MOVE_KEYS[4]={keys::UP,keys::LEFT,keys::DOWN,keys::RIGHT};   // mismo orden que DIRS
+constexpr int32_t CLOSED=-2;            // dirección bloqueada por pared/puerta
+constexpr int BFS_MAX=4096;             // celdas como máximo al buscar la ficha más cercana
+constexpr double UCB_C=1.0;
+
+inline bool pac_open(const SimState& s,int d){
+    int nx=s.px+DIRS[d][0], ny=s.py+DIRS[d][1]; s.wrap(nx,ny);
+    return !s.solid_for_pacman(nx,ny);
+}
+// Salidas de Pac-Man (bit d = DIRS[d]): del grafo de cruces si el laberinto lo tiene
+inline uint8_t pac_exits(const SimState& s,const JunctionGraph* pg){
+    if(pg) return pg->open[(size_t)pg->cell(s.px,s.py)];
+    uint8_t m=0;
+    for(int d=0;d<4;d++) if(pac_open(s,d)) m|=(uint8_t)(1u<<d);
+    return m;
+}
+inline uint64_t mix(uint64_t z){
+    z+=0x9E3779B97F4A7C15ull;
+    z=(z^(z>>30))*0xBF58476D1CE4E5B9ull; z=(z^(z>>27))*0x94D049BB133111EBull;
+    return (z^(z>>31))|1;
+}
+
+void* pilot_worker(void* arg){
+    Tree* t=(Tree*)arg;
+    Pilot* p=t->owner;
+    while(true){
+        p->barrier.arrive_and_wait();       // A: hay raíz nueva (o salir)
+        if(p->quit) break;
+        t->search(*p,*p->root,p->deadline);
+        p->barrier.arrive_and_wait();       // B
+    }
+    return nullptr;
+}
+}
+
+// ============================================================================
+// Árbol de un hilo
+// ============================================================================
+// Pasos en BFS (con túnel, como Pac-Man) hasta la ficha o power más cercano
+int Tree::nearest_token(const SimState& s){
+    size_t cells=(size_t)s.W*s.H;
+    if(seen.size()!=cells){ seen.assign(cells,0); gen=0; }
+    if(++gen==0){ std::fill(seen.begin(),seen.end(),0); gen=1; }
+    queue.clear();
+    queue.push_back(s.py*s.W+s.px); seen[queue[0]]=gen;
+    size_t head=0;
+    for(int dist=0; head<queue.size() && (int)queue.size()<BFS_MAX; dist++){
+        size_t level_end=queue.size();
+        for(; head<level_end; head++){
+            int c=queue[head], x=c%s.W, y=c/s.W;
+            if(s.dots.test(x,y) || s.pellets.test(x,y)) return dist;
+            for(auto &d:DIRS){
+                int nx=x+d[0], ny=y+d[1]; s.wrap(nx,ny);
+                int nc=ny*s.W+nx;
+                if(seen[nc]==gen || s.solid_for_pacman(nx,ny)) continue;
+                seen[nc]=gen; queue.push_back(nc);
+            }
+        }
+    }
+    return 64;
+}
+
+// Recompensa de la hoja respecto de la raíz: puntos ganados, un extra por ficha
+// comida (más que lo que puede crecer la distancia a la siguiente, si no comer
+// la última de una zona parecería malo), vidas perdidas, victoria y qué tan
+// lejos quedó la próxima ficha
+double Tree::evaluate(const SimState& root){
+    const SimState& s=scratch;
+    double r=(double)(s.score-root.score) + 100.0*(root.tokens-s.tokens) - 300.0*(root.lives-s.lives);
+    if(s.tokens<=0) r+=1000.0;
+    else{
+        if(tt.empty()) tt.assign(TT_SIZE,TTEntry{0,-1});
+        TTEntry& e=tt[(size_t)(s.zhash&(TT_SIZE-1))];
+        tt_probes++;
+        if(e.dist>=0 && e.key==s.zhash) tt_hits++;
+        else e=TTEntry{s.zhash,nearest_token(s)};
+        r-=e.dist;
+    }
+    return r;
+}
+
+void Tree::search(const Pilot& p,const SimState& root,uint64_t deadline){
+    const Options& o=p.opt;
+    nodes.clear();
+    nodes.push_back(Node{{-1,-1,-1,-1},-1,0,0.0});
+    lo=hi=0;
+    nodes_sim=0; iters=0;
+
+    const JunctionGraph* pg=root.maze->pac_graph.get();
+    for(int it=0; it<o.iters; it++){
+        if(deadline && (it&15)==15 && now_ns()>=deadline) break;
+        scratch=root;
+        int n=0;
+
+        // Selección: baja mientras el nodo ya esté expandido
+        while(nodes[(size_t)n].visits>0 && !game_finished(scratch)){
+            Node& nd=nodes[(size_t)n];
+            if(nd.child[0]==-1 && nd.child[1]==-1 && nd.child[2]==-1 && nd.child[3]==-1){
+                bool any=false;
+                uint8_t ex=pac_exits(scratch,pg);
+                for(int d=0;d<4;d++){
+                    if(!(ex>>d&1)){ nodes[(size_t)n].child[d]=CLOSED; continue; }
+                    nodes.push_back(Node{{-1,-1,-1,-1},n,0,0.0});
+                    nodes[(size_t)n].child[d]=(int32_t)nodes.size()-1;
+                    any=true;
+                }
+                if(!any) break;
+            }
+            const Node& cur=nodes[(size_t)n];
+            int best=-1; double best_v=-1e300;
+            double span=std::max(hi-lo,1e-9), logn=std::log((double)cur.visits);
+            int off=(int)(next()&3);
+            for(int j=0;j<4;j++){
+                int d=(j+off)&3;
+                int32_t c=cur.child[d];
+                if(c<0) continue;
+                const Node& ch=nodes[(size_t)c];
+                double v = ch.visits==0 ? 1e300
+                         : (ch.value/ch.visits-lo)/span + UCB_C*std::sqrt(logn/ch.visits);
+                if(v>best_v){ best_v=v; best=d; }
+            }
+            if(best<0) break;
+            int child=cur.child[best];
+            sim_tick(scratch,MOVE_KEYS[best],o.mode); nodes_sim++;
+            n=child;
+            if(nodes[(size_t)n].visits==0) break;     // hoja nueva: de acá el rollout
+        }
+
+        // Rollout: sigue la dirección actual y a veces gira (como RandomPolicy)
+        int dir=0;
+        for(int d=0;d<4;d++) if(DIRS[d][0]==scratch.pdx && DIRS[d][1]==scratch.pdy) dir=d;
+        for(int k=0; k<o.rollout && !game_finished(scratch); k++){
+            uint8_t ex=pac_exits(scratch,pg);
+            if(!(ex>>dir&1) || next()%8==0){
+                int opts[4], m=0;
+                for(int d=0;d<4;d++) if(ex>>d&1) opts[m++]=d;
+                if(m>0) dir=opts[next()%m];
+            }
+            sim_tick(scratch,MOVE_KEYS[dir],o.mode); nodes_sim++;
+        }
+
+        double r=evaluate(root);
+        if(iters==0) lo=hi=r;
+        lo=std::min(lo,r); hi=std::max(hi,r);
+        for(int k=n; k>=0; k=nodes[(size_t)k].parent){ nodes[(size_t)k].visits++; nodes[(size_t)k].value+=r; }
+        iters++;
+    }
+}
+
+// ============================================================================
+// Piloto
+// ============================================================================
+Pilot::Pilot(const Options& o): opt(o){
+    int n=opt.threads>0? opt.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(n<1) n=1;
+    opt.threads=n;
+    trees.resize((size_t)n);
+    for(Tree& t: trees){ t.owner=this; t.nodes.reserve((size_t)opt.iters*4+1); }
+    barrier.init(n);
+    th.resize((size_t)n-1);
+    for(int k=1;k<n;k++) pthread_create(&th[(size_t)k-1],nullptr,pilot_worker,&trees[(size_t)k]);
+}
+
+Pilot::~Pilot(){
+    quit=true;
+    if(!th.empty()) barrier.arrive_and_wait();
+    for(pthread_t& t: th) pthread_join(t,nullptr);
+}
+
+keys::Key Pilot::decide(const SimState& s){
+    uint64_t t0=now_ns();
+    root=&s;
+    deadline = opt.budget_us? t0+opt.budget_us*1000 : 0;
+    for(size_t k=0;k<trees.size();k++) trees[k].rng=mix(opt.seed*0x100000001b3ull+stats.decisions*trees.size()+k);
+
+    if(!th.empty()) barrier.arrive_and_wait();  // A
+    trees[0].search(*this,s,deadline);
+    if(!th.empty()) barrier.arrive_and_wait();  // B
+
+    // Jugada más visitada sumando todos los árboles (la media con pocas
+    // visitas es ruidosa); a igual visitas, la de mejor recompensa media
+    uint64_t visits[4]={0,0,0,0};
+    double value[4]={0,0,0,0};
+    for(Tree& t: trees){
+        const Tree::Node& r=t.nodes[0];
+        for(int d=0;d<4;d++) if(r.child[d]>=0){
+            const Tree::Node& c=t.nodes[(size_t)r.child[d]];
+            visits[d]+=c.visits; value[d]+=c.value;
+        }
+        stats.nodes+=t.nodes_sim; stats.iters+=t.iters;
+        stats.tt_probes+=t.tt_probes; stats.tt_hits+=t.tt_hits; t.tt_probes=t.tt_hits=0;
+    }
+    int best=-1;
+    for(int d=0;d<4;d++){
+        if(visits[d]==0) continue;
+        if(best<0 || visits[d]>visits[best] || (visits[d]==visits[best] && value[d]/visits[d]>value[best]/visits[best])) best=d;
+    }
+    stats.decisions++;
+    stats.ns+=now_ns()-t0;
+    return best<0? keys::NONE : MOVE_KEYS[best];
+}
+
+} // namespace agent
@@ -0,0 +1,88 @@
+#pragma once
+// Piloto automático: búsqueda en árbol sobre copias baratas de SimState
+#include <vector>
+#include <cstdint>
+#include <pthread.h>
+#include "game.hpp"
+#include "engine.hpp"
+
+// ============================================================================
+// Piloto automático (MCTS en paralelo por raíz)
+// ============================================================================
+// Cada hilo arma su propio árbol UCT desde el estado actual: baja por UCB1
+// re-simulando la rama sobre una copia (lazo abierto: los nodos guardan solo la
+// jugada), expande, hace un rollout corto con la política aleatoria y propaga la
+// recompensa. Al final se suman las visitas de las jugadas de la raíz de todos
+// los árboles y se elige la más visitada. Los fantasmas son deterministas (en
+// Modo 3 se supone que Blinky sigue la IA). "Nodo" = un tick simulado.
+namespace agent {
+
+struct Options {
+    int threads=0;              // 0 = núcleos disponibles (el llamador cuenta como uno)
+    int iters=256;              // iteraciones por hilo y por jugada
+    int rollout=16;             // ticks de rollout desde la hoja
+    uint64_t budget_us=0;       // tope de tiempo por jugada (0 = solo iteraciones)
+    uint64_t seed=1;
+    GameMode mode=MODE_1;
+};
+
+struct Stats {
+    uint64_t decisions=0, nodes=0, iters=0, ns=0;
+    uint64_t tt_probes=0, tt_hits=0;    // tabla de transposición de las hojas
+    double nodes_per_s() const { return ns? nodes*1e9/ns : 0.0; }
+    double us_per_decision() const { return decisions? ns/1000.0/decisions : 0.0; }
+};
+
+struct Pilot;
+
+// Árbol y copias de trabajo de un hilo (reusados entre jugadas: sin allocs)
+struct Tree {
+    struct Node {
+        int32_t child[4];       // índice por dirección de DIRS; -1 sin expandir, -2 cerrada
+        int32_t parent;
+        uint32_t visits;
+        double value;           // suma de recompensas
+    };
+    Pilot* owner=nullptr;
+    std::vector<Node> nodes;
+    SimState scratch;
+    // Transposición: distancia a la próxima ficha por hash de Zobrist de la hoja
+    // (mapeo directo; una hoja ya vista, por otro camino o en la jugada
+    // anterior, no repite el BFS). El valor es exacto: no cambia la búsqueda.
+    struct TTEntry { uint64_t key; int32_t dist; };
+    static constexpr size_t TT_SIZE=1u<<14;
+    std::vector<TTEntry> tt;
+    uint64_t tt_probes=0, tt_hits=0;
+    std::vector<uint32_t> seen;         // BFS a la ficha más cercana (marcas por generación)
+    std::vector<int32_t> queue;
+    uint32_t gen=0;
+    uint64_t rng=1;
+    double lo=0, hi=0;                  // rango de recompensas visto (normaliza UCB)
+    uint64_t nodes_sim=0, iters=0;
+
+    uint32_t next(){ rng^=rng<<13; rng^=rng>>7; rng^=rng<<17; return (uint32_t)(rng>>32); }
+    void search(const Pilot& p,const SimState& root,uint64_t deadline);
+    double evaluate(const SimState& root);
+    int nearest_token(const SimState& s);
+};
+
+struct Pilot {
+    Options opt;
+    Stats stats;
+    std::vector<Tree> trees;            // trees[0] = el hilo que llama a decide
+    std::vector<pthread_t> th;
+    tsync::PhaseBarrier barrier{1};
+    const SimState* root=nullptr;
+    uint64_t deadline=0;
+    bool quit=false;
+
+    explicit Pilot(const Options& o);
+    ~Pilot();
+    Pilot(const Pilot&)=delete;
+    Pilot& operator=(const Pilot&)=delete;
+
+    // Flecha para Pac-Man en este tick (NONE si no hay jugada)
+    keys::Key decide(const SimState& s);
+};
+
+} // namespace agent
@@ -0,0 +1,147 @@
+#include "batch.hpp"
+#include "agent.hpp"
+#include "level.hpp"
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <pthread.h>
+#include <unistd.h>
+
+namespace batch {
+
+keys::Key script_key(const std::string& script,int tick){
+    if(script.empty()) return keys::NONE;
+    switch(script[(size_t)tick%script.size()]){
+        case 'U': return keys::UP;   case 'D': return keys::DOWN;
+        case 'L': return keys::LEFT; case 'R': return keys::RIGHT;
+        case 'w': return keys::W;    case 'a': return keys::A;
+        case 's': return keys::S;    case 'd': return keys::D;
+        default:  return keys::NONE;
+    }
+}
+
+Result run_game(const Options& o,int index){
+    Result r;
+    std::shared_ptr<const Maze> maze=Maze::current();
+    if(!o.gen.empty()){
+        level::GenOptions go;
+        level::parse_gen(o.gen,go);
+        go.seed=o.seed+(uint64_t)index;
+        uint64_t t0=now_ns();
+        std::string err;
+        maze=level::generate(go,&err);
+        r.gen_ns=now_ns()-t0;
+        if(!maze){ fprintf(stderr,"partida %d: %s\n",index,err.c_str()); maze=Maze::current(); }
+    }
+    // La tabla entre cruces se arma antes del primer tick (y se mide aparte)
+    if(GHOST_NAV==NAV_PATH){ uint64_t t0=now_ns(); r.path=maze->path_tables(); r.nav_ns=now_ns()-t0; }
+    GameState s(maze,GHOST_COUNT);
+    r.ghosts=s.gh.n;
+    s.blinky_human=(o.mode==MODE_3);
+    RandomPolicy pol(o.seed+(uint64_t)index);
+    std::unique_ptr<agent::Pilot> pilot;
+    if(o.agent){
+        agent::Options ao; ao.threads=o.agent_threads; ao.iters=o.agent_iters;
+        ao.seed=o.seed+(uint64_t)index; ao.mode=o.mode;
+        pilot=std::make_unique<agent::Pilot>(ao);
+    }
+    while(!game_finished(s) && s.tick_id<o.max_ticks){
+        keys::Key k = pilot? pilot->decide(s) : o.script.empty()? pol.pick(s) : script_key(o.script,s.tick_id);
+        sim_tick(s,k,o.mode);
+        r.chain=zobrist::chain(r.chain,s.zhash);
+    }
+    r.hash=s.zhash;
+    r.score=s.score; r.ticks=s.tick_id; r.lives=s.lives;
+    if(pilot){ r.agent_nodes=pilot->stats.nodes; r.agent_ns=pilot->stats.ns; }
+    r.outcome = s.tokens<=0 ? 1 : (s.lives<=0 ? 2 : 0);
+    return r;
+}
+
+namespace {
+struct Pool {
+    const Options* o;
+    std::vector<Result>* results;
+    std::atomic<int> next{0};
+};
+
+void* worker(void* arg){
+    Pool* p=(Pool*)arg;
+    while(true){
+        int i=p->next.fetch_add(1);
+        if(i>=p->o->games) break;
+        (*p->results)[(size_t)i]=run_game(*p->o,i);
+    }
+    return nullptr;
+}
+}
+
+int run(const Options& o){
+    int nth=o.threads>0? o.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(nth<1) nth=1;
+    std::vector<Result> results((size_t)o.games);
+    Pool pool{&o,&results};
+
+    uint64_t t0=now_ns();
+    std::vector<pthread_t> th((size_t)nth);
+    for(auto& t: th) pthread_create(&t,nullptr,worker,&pool);
+    for(auto& t: th) pthread_join(t,nullptr);
+    double dt=(now_ns()-t0)*1e-9;
+
+    // --ghosts tiene que llegar al estado de cada partida (el resumen lo informa)
+    for(size_t i=0;i<results.size();i++) if(results[i].ghosts!=GHOST_COUNT){
+        fprintf(stderr,"partida %zu: %d fantasmas en vez de %d\n",i,results[i].ghosts,GHOST_COUNT);
+        return 1;
+    }
+
+    long long ticks=0; int wins=0, losses=0, timeouts=0;
+    std::vector<int> scores; scores.reserve(results.size());
+    for(const Result& r: results){
+        ticks+=r.ticks; scores.push_back(r.score);
+        if(r.outcome==1) wins++; else if(r.outcome==2) losses++; else timeouts++;
+    }
+    std::sort(scores.begin(),scores.end());
+    auto pct=[&](double p){ return scores.empty()? 0 : scores[(size_t)((scores.size()-1)*p)]; };
+    double mean=0; for(int v: scores) mean+=v; if(!scores.empty()) mean/=scores.size();
+
+    printf("games: %d  threads: %d  seed: %llu  policy: %s  max_ticks: %d  ghosts: %d\n",
+           o.games,nth,(unsigned long long)o.seed,o.agent?"agent":o.script.empty()?"random":"script",o.max_ticks,GHOST_COUNT);
+    printf("time: %.3f s  games/s: %.1f  ticks/s: %.0f\n",dt,o.games/dt,ticks/dt);
+    if(!o.gen.empty()){
+        uint64_t ns=0, nav_ns=0; int path=0;
+        for(const Result& r: results){ ns+=r.gen_ns; nav_ns+=r.nav_ns; path+=r.path; }
+        printf("levels: gen:%s por partida  ms/nivel: %.2f\n",o.gen.c_str(),ns/1e6/o.games);
+        // Con demasiados cruces para la tabla, NAV_PATH navega por euclídea
+        if(GHOST_NAV==NAV_PATH)
+            printf("nav: path en %d/%d partidas (resto euclídea)  tabla de cruces ms/nivel: %.2f\n",
+                   path,o.games,nav_ns/1e6/o.games);
+    }
+    if(o.agent){
+        uint64_t nodes=0, ns=0;
+        for(const Result& r: results){ nodes+=r.agent_nodes; ns+=r.agent_ns; }
+        printf("agent: iters %d x %d hilos  nodes: %llu  nodes/s por partida: %.0f  total: %.0f\n",
+               o.agent_iters,o.agent_threads,(unsigned long long)nodes,ns? nodes*1e9/ns : 0.0,dt>0? nodes/dt : 0.0);
+    }
+    printf("win: %d  loss: %d  timeout: %d\n",wins,losses,timeouts);
+    // Cadena de todas las partidas en orden: una sola línea para comparar corridas
+    uint64_t chain=0;
+    for(const Result& r: results) chain=zobrist::chain(chain,r.chain);
+    printf("checksum: %016llx\n",(unsigned long long)chain);
+    if(o.checksums)
+        for(size_t i=0;i<results.size();i++)
+            printf("  #%zu ticks %d hash %016llx cadena %016llx\n",i,results[i].ticks,
+                   (unsigned long long)results[i].hash,(unsigned long long)results[i].chain);
+    printf("score min/p10/p50/p90/max: %d / %d / %d / %d / %d  mean: %.1f\n",
+           pct(0),pct(0.10),pct(0.50),pct(0.90),pct(1.0),mean);
+    // Histograma simple de puntajes (10 buckets)
+    if(!scores.empty() && scores.back()>scores.front()){
+        int lo=scores.front(), hi=scores.back(); int bw=(hi-lo+9)/10;
+        int hist[10]={0};
+        for(int v: scores){ int b=(v-lo)/bw; if(b>9) b=9; hist[b]++; }
+        for(int b=0;b<10;b++) printf("  [%6d, %6d) %d\n",lo+b*bw,lo+(b+1)*bw,hist[b]);
+    }
+    return 0;
+}
+
+} // namespace batch
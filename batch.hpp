@@ -0,0 +1,57 @@
+#pragma once
+// Modo batch (headless): muchas partidas sin render ni sleeps, en paralelo
+#include <string>
+#include <cstdint>
+#include "game.hpp"
+
+namespace batch {
+
+struct Options {
+    int games=1000;
+    int threads=0;              // 0 = núcleos disponibles
+    uint64_t seed=1;
+    int max_ticks=5000;         // corta partidas que no terminan
+    GameMode mode=MODE_1;
+    std::string script;         // vacío => política aleatoria
+    bool agent=false;           // piloto automático (búsqueda) en vez de la política aleatoria
+    int agent_iters=256;        // iteraciones por hilo y por jugada
+    int agent_threads=1;        // hilos de búsqueda por partida
+    bool checksums=false;       // una línea por partida con su hash final y su cadena
+    std::string gen;            // "WxH[:ends]...": un laberinto generado por partida (semilla = seed + índice)
+};
+
+struct Result {
+    int score=0; int ticks=0; int lives=0; int outcome=0;  // 0 timeout, 1 win, 2 loss
+    uint64_t agent_nodes=0, agent_ns=0;                     // con --agent
+    uint64_t hash=0, chain=0;   // hash de Zobrist final y cadena de los hashes de cada tick
+    uint64_t gen_ns=0;          // con gen: generar y validar el laberinto
+    uint64_t nav_ns=0;          // con gen y NAV_PATH: armar la tabla entre cruces
+    bool path=false;            // los fantasmas navegaron por camino (no euclídea)
+    int ghosts=0;               // fantasmas que tuvo la partida (debe ser GHOST_COUNT)
+};
+
+// Política aleatoria con inercia: sigue la dirección actual y a veces gira
+struct RandomPolicy {
+    uint64_t st;
+    int dir=2;
+    explicit RandomPolicy(uint64_t seed): st(seed*0x9E3779B97F4A7C15ull+1) {}
+    uint32_t next(){ st^=st<<13; st^=st>>7; st^=st<<17; return (uint32_t)(st>>32); }
+    keys::Key pick(const SimState& s){
+        static const keys::Key K[4]={keys::UP,keys::LEFT,keys::DOWN,keys::RIGHT}; // mismo orden que DIRS
+        auto open=[&](int d){ int nx=s.px+DIRS[d][0], ny=s.py+DIRS[d][1]; int wx=nx,wy=ny; s.wrap(wx,wy); return !s.solid_for_pacman(wx,wy); };
+        if(!open(dir) || next()%8==0){
+            int opts[4], n=0;
+            for(int d=0;d<4;d++) if(open(d)) opts[n++]=d;
+            if(n>0) dir=opts[next()%n];
+        }
+        return K[dir];
+    }
+};
+// Guion: una letra por tick (U/D/L/R, w/a/s/d para Blinky, '.' nada), en bucle
+keys::Key script_key(const std::string& script,int tick);
+// Una partida completa en este hilo (semilla = o.seed + index)
+Result run_game(const Options& o,int index);
+// Corre o.games partidas en un pool de hilos e imprime el resumen
+int run(const Options& o);
+
+} // namespace batch
@@ -0,0 +1,1000 @@
+// Microbenchmarks de los caminos calientes; salida JSON para comparar versiones
+//
+//   pacman_bench [--out FILE] [--min-ms N] [--filter TEXTO] [--scores-max N]
+//                [--sync-ticks N] [--sync-tick-us U] [--pool-ticks N] [--workers N]
+//                [--level-size N] [--net-ticks N] [--server-sessions N]
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include "term.hpp"
+#include "game.hpp"
+#include "render.hpp"
+#include "scores.hpp"
+#include "engine.hpp"
+#include "batch.hpp"
+#include "prof.hpp"
+#include "level.hpp"
+#include "agent.hpp"
+#include "net.hpp"
+#include "cast.hpp"
+#include "vecenv.hpp"
+#include "server.hpp"
+#include "coro.hpp"
+#include "builtin.hpp"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+// ============================================================================
+// Arnés: calibra iteraciones hasta superar min_ms y reporta ns/op
+// ============================================================================
+template<class T> inline void keep(const T& v){ asm volatile("" : : "r,m"(v) : "memory"); }
+
+struct Result {
+    std::string name;
+    uint64_t iters=0;
+    double ns_per_op=0;
+    std::vector<std::pair<std::string,double>> extra;   // métricas propias (bytes/frame, etc.)
+};
+
+static std::vector<Result> g_results;
+static double g_min_ms=200;
+static std::string g_filter;
+
+static bool wanted(const std::string& name){ return g_filter.empty() || name.find(g_filter)!=std::string::npos; }
+
+// fn(n) ejecuta n operaciones; se duplica n hasta que una pasada dure min_ms
+static Result& bench(const std::string& name,const std::function<void(uint64_t)>& fn){
+    Result r; r.name=name;
+    uint64_t n=1;
+    for(;;){
+        uint64_t t0=now_ns(); fn(n); uint64_t dt=now_ns()-t0;
+        if(dt>=g_min_ms*1e6 || n>=(1ull<<32)){ r.iters=n; r.ns_per_op=(double)dt/n; break; }
+        // Salto proporcional para no gastar demasiadas pasadas cortas
+        uint64_t want = dt>0 ? (uint64_t)(n*(g_min_ms*1e6*1.2/dt)) : n*100;
+        n = std::max(n*2, std::min(want, n*100));
+    }
+    fprintf(stderr,"%-44s %12.1f ns/op  (%llu it)\n",name.c_str(),r.ns_per_op,(unsigned long long)r.iters);
+    g_results.push_back(r);
+    return g_results.back();
+}
+
+// Estado con los fantasmas ya fuera de la casa (lo típico a mitad de partida)
+static GameState warm_state(int ticks){
+    GameState s; s.lives=1<<30;
+    batch::RandomPolicy pol(1);
+    for(int i=0;i<ticks && !game_finished(s);i++) sim_tick(s,pol.pick(s),MODE_1);
+    return s;
+}
+
+// ============================================================================
+// Render
+// ============================================================================
+// Grilla de bloques 2x2 con pasillos de 2 celdas y la casa en el centro
+static std::vector<std::string> grid_level(int n){
+    std::vector<std::string> g((size_t)n,std::string((size_t)n,TOKEN));
+    for(int y=0;y<n;y++) for(int x=0;x<n;x++)
+        if(x==0||y==0||x==n-1||y==n-1 || (x%4>=2 && y%4>=2)) g[y][x]=WALL;
+    int cx=n/2, cy=n/2;
+    for(int y=cy-3;y<=cy+2;y++) for(int x=cx-5;x<=cx+5;x++) g[y][x]=TOKEN;
+    for(int y=cy-2;y<=cy+2;y++) for(int x=cx-4;x<=cx+4;x++)
+        g[y][x]= (y==cy-2||y==cy+2||x==cx-4||x==cx+4)? WALL : EMPTY;
+    for(int x=cx-1;x<=cx+1;x++) g[cy-2][x]=DOOR;
+    g[1][1]='S';
+    return g;
+}
+static bool write_grid_level(const std::string& path,int n){
+    FILE* f=fopen(path.c_str(),"w");
+    if(!f) return false;
+    for(auto& r: grid_level(n)){ fwrite(r.data(),1,r.size(),f); fputc('\n',f); }
+    return fclose(f)==0;
+}
+
+static void bench_render(int big){
+    int devnull=::open("/dev/null",O_WRONLY|O_CLOEXEC);
+    int saved_fd=g_renderer.out_fd;
+    g_renderer.out_fd=devnull;
+    term::cached_cols=120; term::cached_rows=40; term::size_dirty=false;
+
+    GameState a=warm_state(100), b=warm_state(101);   // b = a + 1 tick
+
+    if(wanted("render/full")){
+        g_renderer.reset_stats();
+        Result& r=bench("render/full",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){ g_renderer.invalidate(); render_locked(a); }
+        });
+        r.extra.push_back({"bytes_per_frame",(double)g_renderer.bytes_total/std::max<uint64_t>(1,g_renderer.frames)});
+    }
+    if(wanted("render/diff")){
+        // Alterna dos estados consecutivos: cada frame es el diff de un tick
+        g_renderer.invalidate(); render_locked(a);
+        g_renderer.reset_stats();
+        Result& r=bench("render/diff",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++) render_locked((i&1)? a : b);
+        });
+        r.extra.push_back({"bytes_per_frame",(double)g_renderer.bytes_total/std::max<uint64_t>(1,g_renderer.frames)});
+    }
+    // Grabación asciicast a /dev/null: costo en el hilo del render (el escritor
+    // corre aparte) y frames que no entraron en el anillo
+    for(bool diff: {false,true}){
+        std::string name=std::string("render/record/")+(diff? "diff" : "full");
+        if(!wanted(name)) continue;
+        cast::Recorder rec;
+        if(!rec.open("/dev/null",120,40,diff)) continue;
+        g_renderer.rec=&rec;
+        g_renderer.invalidate(); render_locked(a);
+        Result& r=bench(name,[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++) render_locked((i&1)? a : b);
+        });
+        rec.close();
+        g_renderer.rec=nullptr;
+        uint64_t fr=std::max<uint64_t>(1,rec.frames.load());
+        r.extra.push_back({"bytes_per_frame",(double)rec.bytes_in.load()/fr});
+        r.extra.push_back({"dropped_pct",100.0*rec.dropped.load()/fr});
+        r.extra.push_back({"write_mb_s",rec.mb_per_s()});
+    }
+    if(wanted("render/build_cells")){
+        bench("render/build_cells",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){ g_renderer.build_cells(a); keep(g_renderer.cur[0]); }
+        });
+    }
+    // Ventana de 120x40 que sigue a Pac-Man por un laberinto grande; cada
+    // frame corre la cámara un paso (peor caso: el diff cambia casi todo)
+    std::string base="render/viewport_"+std::to_string(big);
+    if(big>=16 && wanted(base)){
+        auto m=Maze::from_text(grid_level(big));
+        GameState s(m,64); s.lives=1<<30;
+        batch::RandomPolicy pol(2);
+        for(int i=0;i<200;i++) sim_tick(s,pol.pick(s),MODE_1);
+        int y0=s.py;
+        g_renderer.minimap=true;
+        g_renderer.invalidate(); render_locked(s);
+        g_renderer.reset_stats();
+        Result& r=bench(base+"/diff",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){ s.py=y0+(int)(i%64); render_locked(s); }
+        });
+        r.extra.push_back({"bytes_per_frame",(double)g_renderer.bytes_total/std::max<uint64_t>(1,g_renderer.frames)});
+        r.extra.push_back({"cells",(double)g_renderer.W*g_renderer.H});
+        s.py=y0;
+        bench(base+"/still",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++) render_locked(s);
+        });
+        g_renderer.minimap=false;
+    }
+    g_renderer.out_fd=saved_fd;
+    g_renderer.invalidate();
+    g_renderer.reset_stats();
+    ::close(devnull);
+}
+
+// ============================================================================
+// IA de fantasmas y colisiones
+// ============================================================================
+// Foto de un fantasma para repetir el mismo paso (restaura también la ocupación)
+struct GhostSnap { int x,y,dx,dy,in_house,release; };
+static GhostSnap ghost_snap(const GameState& s,int i){
+    const Ghosts& g=s.gh;
+    return {g.x[i],g.y[i],g.dx[i],g.dy[i],g.in_house[i],g.release[i]};
+}
+static void ghost_restore(GameState& s,int i,const GhostSnap& v){
+    Ghosts& g=s.gh;
+    if(!g.in_house[i]) s.occ.sub(g.x[i],g.y[i],g.kind[i]);
+    g.x[i]=(int16_t)v.x; g.y[i]=(int16_t)v.y; g.dx[i]=(int8_t)v.dx; g.dy[i]=(int8_t)v.dy;
+    g.in_house[i]=(uint8_t)v.in_house; g.release[i]=v.release;
+    if(!g.in_house[i]) s.occ.add(g.x[i],g.y[i],g.kind[i]);
+}
+
+static void bench_ai(){
+    GhostNav saved=GHOST_NAV;
+    struct Nav { const char* name; GhostNav nav; };
+    Nav navs[]={{"path",NAV_PATH},{"euclid",NAV_EUCLID}};
+    for(const Nav& nv: navs){
+        GHOST_NAV=nv.nav;
+        GameState s=warm_state(200);
+        for(int i=0;i<s.gh.n;i++){
+            std::string base=std::string("ai/")+nv.name+"/"+GHOST_NAMES[s.gh.kind[i]];
+            if(wanted(base+"/compute_target")){
+                bench(base+"/compute_target",[&](uint64_t n){
+                    int tx=0,ty=0;
+                    for(uint64_t k=0;k<n;k++){ compute_target(s,i,tx,ty); keep(tx); keep(ty); }
+                });
+            }
+            if(wanted(base+"/step_towards")){
+                int tx=0,ty=0; compute_target(s,i,tx,ty);
+                GhostSnap g0=ghost_snap(s,i);
+                bench(base+"/step_towards",[&](uint64_t n){
+                    for(uint64_t k=0;k<n;k++){ ghost_restore(s,i,g0); step_towards(s,i,tx,ty); keep(s.gh.x[i]); }
+                });
+                ghost_restore(s,i,g0);
+            }
+            if(wanted(base+"/ghost_tick_ai")){
+                GhostSnap g0=ghost_snap(s,i);
+                bench(base+"/ghost_tick_ai",[&](uint64_t n){
+                    for(uint64_t k=0;k<n;k++){ ghost_restore(s,i,g0); ghost_tick_ai(s,i); keep(s.gh.x[i]); }
+                });
+                ghost_restore(s,i,g0);
+            }
+        }
+    }
+
+    // Nivel generado sin tabla completa de celdas: por camino va por la tabla
+    // entre cruces (se arma con la primera consulta); el costo por tick no
+    // depende del objetivo
+    if(wanted("ai/gen101")){
+        level::GenOptions go; go.W=go.H=101; go.seed=3;
+        std::shared_ptr<const Maze> m=level::generate(go);
+        for(const Nav& nv: navs){
+            std::string name=std::string("ai/gen101/")+nv.name+"/ghost_tick_ai";
+            if(!m || !wanted(name)) continue;
+            GHOST_NAV=nv.nav;
+            GameState s(m); s.lives=1<<30;
+            batch::RandomPolicy pol(1);
+            uint64_t t0=now_ns();
+            for(int i=0;i<200 && !game_finished(s);i++) sim_tick(s,pol.pick(s),MODE_1);
+            double warm_ms=(now_ns()-t0)/1e6;
+            Result& r=bench(name,[&](uint64_t n){
+                for(uint64_t k=0;k<n;k++){
+                    for(int i=0;i<s.gh.n;i++){ GhostSnap g0=ghost_snap(s,i); ghost_tick_ai(s,i); keep(s.gh.x[i]); ghost_restore(s,i,g0); }
+                }
+            });
+            r.extra={{"junctions",m->ghost_graph? (double)m->ghost_graph->nodes.size() : 0},{"warm_ms",warm_ms}};
+        }
+    }
+    GHOST_NAV=saved;
+
+    if(wanted("rules/handle_collisions")){
+        GameState s=warm_state(200);
+        bench("rules/handle_collisions",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){ handle_collisions(s); keep(s.lives); }
+        });
+    }
+}
+
+// ============================================================================
+// Grafo de cruces: decisiones de los fantasmas por tick y distancias
+// ============================================================================
+static void bench_graph(){
+    std::shared_ptr<const Maze> m=Maze::builtin();
+    const JunctionGraph* jg=m->ghost_graph.get();
+    if(!jg) return;
+    if(wanted("graph/build")){
+        Result& r=bench("graph/build",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){
+                JunctionGraph g(m->walls,nullptr,false); keep(g.edges.size());
+                JunctionGraph p(m->walls,&m->doors,true); keep(p.edges.size());
+            }
+        });
+        size_t open=0, corr=0;
+        for(int c=0;c<jg->W*jg->H;c++) if(jg->open[(size_t)c]){ open++; corr+=jg->corridor(c); }
+        r.extra={{"nodes",(double)jg->nodes.size()},{"edges",(double)jg->edges.size()},
+                 {"corridor_frac",open? (double)corr/open : 0}};
+    }
+    if(wanted("graph/distance")){
+        // Pares al azar de celdas libres; se contrasta con la fila BFS del campo
+        std::vector<int> cells;
+        for(int c=0;c<jg->W*jg->H;c++) if(jg->open[(size_t)c] && m->dist->node(c%jg->W,c/jg->W)>=0) cells.push_back(c);
+        uint64_t rng=12345, mismatches=0;
+        auto pick=[&]{ rng=rng*6364136223846793005ull+1442695040888963407ull; return cells[(size_t)((rng>>33)%cells.size())]; };
+        for(int k=0;k<2000;k++){
+            int a=pick(), b=pick();
+            const uint16_t* row=m->dist->from(m->dist->node(b%jg->W,b/jg->W));
+            int want=row[m->dist->node(a%jg->W,a/jg->W)];
+            if(jg->distance(a%jg->W,a/jg->W,b%jg->W,b/jg->W)!=want) mismatches++;
+        }
+        Result& r=bench("graph/distance",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){ int a=pick(), b=pick(); keep(jg->distance(a%jg->W,a/jg->W,b%jg->W,b/jg->W)); }
+        });
+        r.extra={{"mismatches",(double)mismatches}};
+
+        // La tabla entre cruces (la que usan los niveles grandes) contra la misma fila
+        JunctionGraph tg(m->walls,nullptr,false);
+        uint64_t tmis=0;
+        for(int k=0;k<2000;k++){
+            int a=pick(), b=pick();
+            const uint16_t* row=m->dist->from(m->dist->node(b%jg->W,b/jg->W));
+            if(tg.table_distance(a,b)!=row[m->dist->node(a%jg->W,a/jg->W)]) tmis++;
+        }
+        Result& t=bench("graph/table_distance",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){ int a=pick(), b=pick(); keep(tg.table_distance(a,b)); }
+        });
+        t.extra={{"mismatches",(double)tmis}};
+    }
+    // Antes = toda celda fuera de la casa es una decisión (objetivo + vecinos);
+    // después = solo las que no tienen una única continuación
+    bool saved=GHOST_CORRIDORS;
+    for(int n: {4,64}){
+        std::string base="ai/decisions/"+std::to_string(n);
+        if(!wanted(base)) continue;
+        for(bool on: {false,true}){
+            GHOST_CORRIDORS=on;
+            GameState s(m,n); s.lives=1<<30;
+            batch::RandomPolicy pol(5);
+            for(int i=0;i<200;i++) sim_tick(s,pol.pick(s),MODE_1);
+            uint64_t steps=0, decisions=0, ticks=0;
+            for(int t=0;t<2000 && !game_finished(s);t++,ticks++){
+                for(int i=0;i<s.gh.n;i++){
+                    if(s.gh.in_house[i]) continue;
+                    steps++;
+                    decisions+=jg->continuation(jg->cell(s.gh.x[i],s.gh.y[i]),s.gh.dx[i],s.gh.dy[i])<0;
+                }
+                sim_tick(s,pol.pick(s),MODE_1);
+            }
+            GameState s0(m,n); s0.lives=1<<30;
+            for(int i=0;i<200;i++) sim_tick(s0,pol.pick(s0),MODE_1);
+            std::string name=base+(on? "/corridors" : "/every_cell");
+            Result& r=bench(name,[&](uint64_t k){
+                for(uint64_t i=0;i<k;i++){
+                    if(game_finished(s0)){ s0=GameState(m,n); s0.lives=1<<30; }
+                    sim_tick(s0,pol.pick(s0),MODE_1);
+                }
+            });
+            double per_tick= ticks? (double)(on? decisions : steps)/ticks : 0;
+            r.extra={{"decisions_per_tick",per_tick},{"ghost_steps_per_tick",ticks? (double)steps/ticks : 0}};
+            fprintf(stderr,"%-44s %12.2f decisiones/tick\n",name.c_str(),per_tick);
+        }
+    }
+    GHOST_CORRIDORS=saved;
+}
+
+// ============================================================================
+// Estado y tick completo
+// ============================================================================
+static void bench_state(){
+    if(wanted("state/construct")){
+        bench("state/construct",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){ GameState s; keep(s.tokens); }
+        });
+    }
+    if(wanted("state/reset")){
+        GameState s;
+        bench("state/reset",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){ s=GameState(); keep(s.tokens); }
+        });
+    }
+    if(wanted("state/clone")){
+        // Foto para búsqueda: asignar sobre un SimState del mismo laberinto (sin allocs)
+        SimState a=warm_state(200), b=a;
+        bench("state/clone",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){ b=a; keep(b.tokens); }
+        });
+    }
+    if(wanted("sim/tick")){
+        GameState s; s.lives=1<<30;
+        batch::RandomPolicy pol(3);
+        bench("sim/tick",[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++){
+                if(game_finished(s)){ s=GameState(); s.lives=1<<30; }
+                sim_tick(s,pol.pick(s),MODE_1);
+            }
+        });
+    }
+}
+
+// ============================================================================
+// Entornos vectorizados: pasos de entorno por segundo (1 hilo y todos)
+// ============================================================================
+static void bench_vecenv(){
+    int ncpu=(int)sysconf(_SC_NPROCESSORS_ONLN);
+    std::vector<int> threads={1};
+    if(ncpu>1) threads.push_back(ncpu);
+    for(bool planes: {true,false}) for(int t: threads){
+        std::string name=std::string("vecenv/step/")+(planes? "planes" : "entities")+"/t"+std::to_string(t);
+        if(!wanted(name)) continue;
+        vecenv::Options o; o.n=1024; o.threads=t; o.planes=planes;
+        vecenv::VecEnv env(o,Maze::builtin());
+        // Flechas al azar precalculadas (la política no entra en la medida)
+        static const keys::Key K[4]={keys::UP,keys::LEFT,keys::DOWN,keys::RIGHT};
+        std::vector<uint8_t> acts((size_t)o.n*64);
+        batch::RandomPolicy rnd(9);
+        for(uint8_t& a: acts) a=replay::encode(K[rnd.next()%4],0,0);
+        // Una operación = un paso de un entorno (step() avanza o.n a la vez)
+        uint64_t k=0;
+        Result& r=bench(name,[&](uint64_t n){
+            for(uint64_t i=0;i<n;i+=(uint64_t)o.n){ env.step(&acts[(size_t)(k++%64)*o.n]); keep(env.reward[0]); }
+        });
+        r.extra.push_back({"envs",(double)o.n});
+        r.extra.push_back({"steps_per_s",r.ns_per_op>0? 1e9/r.ns_per_op : 0.0});
+        r.extra.push_back({"episodes",(double)env.episodes});
+    }
+}
+
+// ============================================================================
+// Piloto automático: una jugada (iteraciones fijas) con 1 hilo y con todos
+// ============================================================================
+static void bench_agent(){
+    int ncpu=(int)sysconf(_SC_NPROCESSORS_ONLN);
+    std::vector<int> threads={1};
+    if(ncpu>1) threads.push_back(ncpu);
+    for(int t: threads){
+        std::string name="agent/decide/t"+std::to_string(t);
+        if(!wanted(name)) continue;
+        agent::Options o; o.threads=t; o.iters=256;
+        agent::Pilot p(o);
+        GameState s=warm_state(100);
+        Result& r=bench(name,[&](uint64_t n){
+            for(uint64_t i=0;i<n;i++) keep(p.decide(s));
+        });
+        r.extra.push_back({"nodes_per_s",p.stats.nodes_per_s()});
+        r.extra.push_back({"iters_per_decision",(double)p.stats.iters/std::max<uint64_t>(1,p.stats.decisions)});
+        r.extra.push_back({"tt_hit_rate",(double)p.stats.tt_hits/std::max<uint64_t>(1,p.stats.tt_probes)});
+    }
+}
+
+// ============================================================================
+// Enjambres: tick con N fantasmas, en un hilo y con el pool de workers
+// ============================================================================
+static void bench_swarm(int pool_ticks){
+    for(int n: {4,64,512,4096}){
+        std::string base="swarm/"+std::to_string(n);
+        if(wanted(base+"/sim_tick")){
+            GameState s(Maze::builtin(),n); s.lives=1<<30;
+            batch::RandomPolicy pol(5);
+            for(int i=0;i<200;i++) sim_tick(s,pol.pick(s),MODE_1);   // que salgan de la casa
+            bench(base+"/sim_tick",[&](uint64_t k){
+                for(uint64_t i=0;i<k;i++){
+                    if(game_finished(s)){ s=GameState(Maze::builtin(),n); s.lives=1<<30; }
+                    sim_tick(s,pol.pick(s),MODE_1);
+                }
+            });
+        }
+        if(pool_ticks>0 && wanted(base+"/pool")){
+            // Sesión real sin pausas ni render: Pac-Man + GHOST_WORKERS hilos con barrera
+            int saved=TICK_US; TICK_US=0;
+            GameState s(Maze::builtin(),n); s.lives=1<<30;
+            batch::RandomPolicy pol(5);
+            Session ss; ss.st=&s; ss.render=false; ss.max_ticks=pool_ticks;
+            ss.input=[&](const GameState& g){ return pol.pick(g); };
+            uint64_t t0=now_ns();
+            run_session(ss);
+            uint64_t dt=now_ns()-t0;
+            TickLatency::Summary m=ss.latency.summary();
+            Result r; r.name=base+"/pool"; r.iters=(uint64_t)s.tick_id; r.ns_per_op=s.tick_id? (double)dt/s.tick_id : 0;
+            r.extra={{"workers",(double)ss.workers},{"lat_p50_us",m.p50_us},{"lat_p99_us",m.p99_us}};
+            fprintf(stderr,"%-44s %12.1f ns/tick (%d workers)\n",r.name.c_str(),r.ns_per_op,ss.workers);
+            g_results.push_back(r);
+            TICK_US=saved;
+        }
+    }
+}
+
+// ============================================================================
+// Costo de la instrumentación (apagada debe ser casi nula)
+// ============================================================================
+static void bench_prof(){
+    bool saved=prof::enabled;
+    for(bool on: {false,true}){
+        prof::enabled=on; prof::reset();
+        std::string name=std::string("prof/scope_")+(on? "on" : "off");
+        if(wanted(name)){
+            bench(name,[&](uint64_t n){ for(uint64_t i=0;i<n;i++){ prof::Scope sc(prof::COLLIDE); keep(i); } });
+        }
+        name=std::string("prof/lock_")+(on? "on" : "off");
+        if(wanted(name)){
+            pthread_mutex_t m=PTHREAD_MUTEX_INITIALIZER;
+            bench(name,[&](uint64_t n){ for(uint64_t i=0;i<n;i++){ prof::lock(&m); keep(i); prof::unlock(&m); } });
+        }
+    }
+    prof::enabled=saved; prof::reset();
+}
+
+// ============================================================================
+// Puntajes: guardar con N registros previos
+// ============================================================================
+static bool prefill_scores(long n){
+    int fd=::open(scores::LOG_PATH,O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0644);
+    if(fd<0) return false;
+    std::vector<scores::Record> buf(4096);
+    batch::RandomPolicy rng(n);
+    for(long done=0; done<n; ){
+        size_t k=(size_t)std::min<long>((long)buf.size(),n-done);
+        for(size_t i=0;i<k;i++){
+            scores::Record& r=buf[i]; r=scores::Record{};
+            uint32_t x=rng.next();
+            r.ini[0]='A'+x%26; r.ini[1]='A'+(x>>5)%26; r.ini[2]='A'+(x>>10)%26;
+            r.score=(int32_t)(rng.next()%30000); r.time=1700000000u+(uint32_t)(done+i); r.mode=1+x%3;
+        }
+        if(write(fd,buf.data(),k*sizeof(scores::Record))!=(ssize_t)(k*sizeof(scores::Record))){ ::close(fd); return false; }
+        done+=(long)k;
+    }
+    ::close(fd);
+    return true;
+}
+
+static void bench_scores(long max_records){
+    char cwd[4096]; if(!getcwd(cwd,sizeof cwd)) return;
+    for(long n: {10000L,100000L,1000000L}){
+        if(n>max_records) break;
+        std::string base="scores/"+std::to_string(n);
+        if(!wanted(base)) continue;
+        char dir[]="/tmp/pacman_bench_XXXXXX";
+        if(!mkdtemp(dir) || chdir(dir)!=0){ perror("mkdtemp"); continue; }
+        if(!prefill_scores(n)){ perror("prefill"); (void)!chdir(cwd); continue; }
+
+        // Apertura: el que llama solo abre; el escritor reconstruye índice y
+        // estadísticas leyendo todo el registro (una sola vez) y flush lo espera
+        uint64_t t0=now_ns(); scores::open(false); double caller_ms=(now_ns()-t0)/1e6;
+        scores::flush(); double open_ms=(now_ns()-t0)/1e6;
+        // Percentiles del sketch contra los exactos del registro
+        double q_err=0;
+        {
+            std::vector<scores::Record> all=scores::last((int)n);
+            std::vector<int32_t> v; v.reserve(all.size());
+            for(const scores::Record& x: all) v.push_back(x.score);
+            std::sort(v.begin(),v.end());
+            scores::Summary ss=scores::stats();
+            for(double q: {0.5,0.9,0.99}){
+                int32_t exact=v[(size_t)(q*(double)(v.size()-1))];
+                q_err=std::max(q_err,std::abs(ss.all.quantile(q)-exact)/(double)std::max(exact,1));
+            }
+        }
+        // Guardado asíncrono (lo que paga el menú) y guardado hasta disco
+        Result& r=bench(base+"/save",[&](uint64_t k){
+            for(uint64_t i=0;i<k;i++) save_score_and_update_summary("BEN",(int)(i%30000),1);
+        });
+        scores::flush();
+        r.extra.push_back({"open_rebuild_ms",open_ms});
+        r.extra.push_back({"open_caller_ms",caller_ms});
+        r.extra.push_back({"stats_quantile_rel_err",q_err});
+        r.extra.push_back({"stats_bytes",(double)sizeof(scores::Summary)});
+        bench(base+"/save_flush",[&](uint64_t k){
+            for(uint64_t i=0;i<k;i++){ save_score_and_update_summary("BEN",(int)(i%30000),1); scores::flush(); }
+        });
+        // Sumar el sidecar de otra máquina (acá, una copia del propio con otro
+        // id): desde la segunda vez reemplaza su entrada en vez de sumar
+        scores::flush();
+        {
+            auto o=std::make_unique<scores::Summary>();
+            std::ifstream src(scores::STATS_PATH,std::ios::binary);
+            src.read((char*)o.get(),sizeof(*o));
+            o->source^=1;
+            std::ofstream dst("other.stats",std::ios::binary);
+            dst.write((const char*)o.get(),sizeof(*o));
+        }
+        bench(base+"/merge_stats",[&](uint64_t k){
+            for(uint64_t i=0;i<k;i++) keep(scores::merge_stats("other.stats"));
+        });
+        scores::shutdown();
+
+        unlink(scores::LOG_PATH); unlink(scores::IDX_PATH); unlink(scores::STATS_PATH); unlink(scores::MERGED_PATH); unlink("other.stats");
+        (void)!chdir(cwd); rmdir(dir);
+    }
+}
+
+// ============================================================================
+// Niveles: carga de un laberinto grande (texto y binario) y reset sobre él
+// ============================================================================
+static void bench_level(int size){
+    std::string base="level/"+std::to_string(size);
+    if(size<16 || !wanted(base)) return;
+    char dir[]="/tmp/pacman_bench_XXXXXX";
+    if(!mkdtemp(dir)){ perror("mkdtemp"); return; }
+    std::string txt=std::string(dir)+"/grid.txt", bin=std::string(dir)+"/grid.pmlv";
+    std::string err;
+    std::shared_ptr<const Maze> m;
+    if(write_grid_level(txt,size)) m=level::load_text(txt,&err);
+    if(!m || !level::save_binary(*m,bin)){ fprintf(stderr,"%s: %s\n",base.c_str(),err.c_str()); return; }
+
+    Result& r=bench(base+"/load_text",[&](uint64_t n){
+        for(uint64_t i=0;i<n;i++){ auto x=level::load_text(txt); keep(x.get()); }
+    });
+    r.extra.push_back({"cells",(double)size*size});
+    r.extra.push_back({"tokens",(double)m->tokens0_count});
+    bench(base+"/load_bin",[&](uint64_t n){
+        for(uint64_t i=0;i<n;i++){ auto x=level::load_binary(bin); keep(x.get()); }
+    });
+    GameState s(m);
+    bench(base+"/reset",[&](uint64_t n){
+        for(uint64_t i=0;i<n;i++){ s=GameState(m); keep(s.tokens); }
+    });
+    unlink(txt.c_str()); unlink(bin.c_str()); rmdir(dir);
+}
+
+// Mapa integrado: texto parseado en ejecución contra tablas compiladas
+// (builtin.hpp); "planes" es solo el parseo/copia, "build" suma el resto de
+// Maze::build (distancias y grafos, iguales en los dos)
+static void bench_builtin(){
+    if(!wanted("level/builtin")) return;
+    std::vector<std::string> rows(std::begin(builtin::CLASSIC),std::end(builtin::CLASSIC));
+    bench("level/builtin/text_planes",[&](uint64_t n){
+        for(uint64_t i=0;i<n;i++){ auto m=Maze::parse_text(rows); keep(m.get()); }
+    });
+    bench("level/builtin/tables_planes",[&](uint64_t n){
+        for(uint64_t i=0;i<n;i++){ auto m=builtin::to_maze(builtin::CLASSIC_TABLES); keep(m.get()); }
+    });
+    std::shared_ptr<const Maze> a, b;
+    bench("level/builtin/text_build",[&](uint64_t n){
+        for(uint64_t i=0;i<n;i++){ a=Maze::from_text(rows); keep(a.get()); }
+    });
+    Result& r=bench("level/builtin/tables_build",[&](uint64_t n){
+        for(uint64_t i=0;i<n;i++){ b=Maze::build(builtin::to_maze(builtin::CLASSIC_TABLES),nullptr,true); keep(b.get()); }
+    });
+    // Mismo nivel por los dos caminos (replays y checksums no cambian)
+    r.extra={{"hash_match",(double)(a && b && a->hash==b->hash && a->tokens0_count==b->tokens0_count)}};
+    std::shared_ptr<const Maze> m=Maze::builtin();
+    GameState s(m);
+    bench("level/builtin/reset",[&](uint64_t n){
+        for(uint64_t i=0;i<n;i++){ s=GameState(m); keep(s.tokens); }
+    });
+}
+
+// Generador: laberinto nuevo y validado (incluye Maze::build: tablas y grafos)
+static void bench_gen(){
+    for(int n: {61,1000}){
+        std::string name="level/gen/"+std::to_string(n);
+        if(!wanted(name)) continue;
+        level::GenOptions o; o.W=o.H=n;
+        uint64_t seed=1; int tokens=0;
+        Result& r=bench(name,[&](uint64_t k){
+            for(uint64_t i=0;i<k;i++){ o.seed=seed++; auto m=level::generate(o); tokens=m? m->tokens0_count : -1; keep(tokens); }
+        });
+        r.extra={{"cells",(double)n*n},{"tokens",(double)tokens}};
+    }
+}
+
+// ============================================================================
+// Protocolo de tick: misma partida sin render, condvar vs barrera
+// ============================================================================
+// CPU del proceso y cambios de contexto (cada uno es un despertar de algún hilo)
+struct Usage { double cpu_ms=0; long ctx=0; };
+static Usage usage_now(){
+    rusage u; getrusage(RUSAGE_SELF,&u);
+    Usage r;
+    r.cpu_ms=(u.ru_utime.tv_sec+u.ru_stime.tv_sec)*1e3+(u.ru_utime.tv_usec+u.ru_stime.tv_usec)/1e3;
+    r.ctx=u.ru_nvcsw+u.ru_nivcsw;
+    return r;
+}
+
+static void bench_sync(int ticks,int tick_us){
+    int saved=TICK_US; TICK_US=tick_us;
+    struct Cfg { const char* name; SyncKind k; bool pin; };
+    Cfg cfgs[]={{"condvar",SYNC_CONDVAR,false},{"barrier",SYNC_BARRIER,false},{"barrier+pin",SYNC_BARRIER,true},
+                {"coro",SYNC_CORO,false}};
+    for(const Cfg& c: cfgs){
+        std::string name=std::string("sync/")+c.name;
+        if(!wanted(name)) continue;
+        GameState s; s.lives=1<<30; // que no termine antes de tiempo
+        Session ss; ss.st=&s; ss.sync=c.k; ss.pin=c.pin; ss.render=false; ss.max_ticks=ticks;
+        ss.input=[](const GameState&){ return keys::NONE; };
+        Usage u0=usage_now();
+        uint64_t t0=now_ns();
+        run_session(ss);
+        uint64_t dt=now_ns()-t0;
+        Usage u1=usage_now();
+        TickLatency::Summary m=ss.latency.summary(), j=ss.jitter.summary();
+        double secs=dt/1e9;
+        double cpu_pct= secs>0? (u1.cpu_ms-u0.cpu_ms)/10.0/secs : 0;
+        double wakeups= secs>0? (u1.ctx-u0.ctx)/secs : 0;
+        Result r; r.name=name; r.iters=(uint64_t)s.tick_id; r.ns_per_op=s.tick_id? (double)dt/s.tick_id : 0;
+        r.extra={{"tick_us",(double)tick_us},{"lat_mean_us",m.mean_us},{"lat_p50_us",m.p50_us},
+                 {"lat_p99_us",m.p99_us},{"lat_max_us",m.max_us},{"jitter_p50_us",j.p50_us},{"jitter_p99_us",j.p99_us},
+                 {"cpu_pct",cpu_pct},{"wakeups_per_s",wakeups}};
+        fprintf(stderr,"%-44s %12.1f ns/tick (p99 %.2f us) | jitter p99 %.1f us | cpu %.1f%% | %.0f despertares/s\n",
+                name.c_str(),r.ns_per_op,m.p99_us,j.p99_us,cpu_pct,wakeups);
+        g_results.push_back(r);
+    }
+    TICK_US=saved;
+
+    // Muchas partidas en un solo hilo con el planificador de corrutinas, sin pausa
+    for(int n: {1,100,1000}){
+        std::string name="sync/coro/games/"+std::to_string(n);
+        if(!wanted(name)) continue;
+        std::vector<GameState> st((size_t)n);
+        std::vector<Session> ss((size_t)n);
+        std::vector<batch::RandomPolicy> pol;
+        for(int i=0;i<n;i++) pol.emplace_back((uint64_t)i+1);
+        coro::Scheduler sch;
+        for(int i=0;i<n;i++){
+            st[(size_t)i].lives=1<<30;
+            Session& x=ss[(size_t)i];
+            x.st=&st[(size_t)i]; x.sync=SYNC_CORO; x.render=false; x.max_ticks=ticks;
+            batch::RandomPolicy* p=&pol[(size_t)i];
+            x.input=[p](const GameState& g){ return p->pick(g); };
+            sch.add(x);
+        }
+        Usage u0=usage_now();
+        uint64_t t0=now_ns();
+        sch.run(0);
+        uint64_t dt=now_ns()-t0;
+        Usage u1=usage_now();
+        uint64_t game_ticks=0; for(const GameState& g: st) game_ticks+=(uint64_t)g.tick_id;
+        Result r; r.name=name; r.iters=game_ticks; r.ns_per_op=game_ticks? (double)dt/game_ticks : 0;
+        r.extra={{"games",(double)n},{"game_ticks_per_s",dt? game_ticks*1e9/dt : 0},
+                 {"wakeups",(double)(u1.ctx-u0.ctx)}};
+        fprintf(stderr,"%-44s %12.1f ns/tick de partida (%.0f ticks/s, 1 hilo)\n",name.c_str(),r.ns_per_op,
+                dt? game_ticks*1e9/dt : 0);
+        g_results.push_back(r);
+    }
+}
+
+// Modo 3 por loopback: host con Pac-Man aleatorio y un cliente en otro hilo
+// que manda WASD a ritmo humano (una tecla cada ~1 tick). Bytes por foto y
+// latencia de la tecla hasta la foto del host que la aplicó.
+struct NetClientArgs { int port, tick_us; net::Client c; bool ok=false; };
+static void* net_client_main(void* arg){
+    NetClientArgs* a=(NetClientArgs*)arg;
+    net::Client& c=a->c;
+    if(!c.connect("127.0.0.1",a->port,nullptr) || !c.handshake(5000,nullptr)) return nullptr;
+    a->ok=true;
+    batch::RandomPolicy rnd(7);
+    uint64_t next=now_ns();
+    while(!c.closed && !c.over){
+        c.pump(2);
+        uint64_t now=now_ns();
+        if(now>=next){
+            int d=(int)(rnd.next()%4);
+            c.send_input(DIRS[d][0],DIRS[d][1]);
+            next=now+(uint64_t)a->tick_us*(500+rnd.next()%1000);     // 0.5..1.5 ticks
+        }
+    }
+    return nullptr;
+}
+
+static void bench_net(int ticks){
+    int saved=TICK_US;
+    for(int tick_us: {90000,60000}){
+        std::string name="net/loopback/tick"+std::to_string(tick_us/1000)+"ms";
+        if(!wanted(name)) continue;
+        TICK_US=tick_us;
+        net::Host host;
+        if(!host.listen(0,nullptr)){ fprintf(stderr,"%s: sin socket\n",name.c_str()); continue; }
+        NetClientArgs ca; ca.port=host.port(); ca.tick_us=tick_us;
+        pthread_t th; pthread_create(&th,nullptr,net_client_main,&ca);
+
+        GameState s; s.lives=1<<30; s.blinky_human=true;
+        if(!host.accept_client(*s.maze,MODE_3,s.gh.n,tick_us,5000,nullptr)){
+            host.close(); pthread_join(th,nullptr);
+            fprintf(stderr,"%s: sin cliente\n",name.c_str()); continue;
+        }
+        // Tamaño de una foto completa (lo que costaría mandar el estado entero)
+        net::Snapshot full; full.capture(s);
+        std::vector<uint8_t> tmp; net::encode_snapshot(full,nullptr,0,tmp);
+
+        batch::RandomPolicy pol(RNG_SEED);
+        Session ss; ss.st=&s; ss.mode=MODE_3; ss.render=false; ss.max_ticks=ticks;
+        ss.input=[&](const GameState& g){ return pol.pick(g); };
+        ss.remote=[&](TickInput& in){ host.poll_input(in); };
+        ss.on_tick=[&](const SimState& g){ host.send_tick(g); };
+        uint64_t t0=now_ns();
+        run_session(ss);
+        uint64_t dt=now_ns()-t0;
+        host.bye();
+        pthread_join(th,nullptr);
+        host.close();
+
+        TickLatency lat; lat.ns=ca.c.latency_ns;
+        TickLatency::Summary m=lat.summary();
+        double per_tick= host.snapshots? (double)host.bytes_sent/host.snapshots : 0;
+        Result r; r.name=name; r.iters=(uint64_t)s.tick_id; r.ns_per_op=s.tick_id? (double)dt/s.tick_id : 0;
+        r.extra={{"tick_us",(double)tick_us},{"bytes_per_tick",per_tick},{"full_bytes",(double)tmp.size()},
+                 {"full_snapshots",(double)host.full_snapshots},{"inputs",(double)m.n},
+                 {"input_p50_ms",m.p50_us/1000.0},{"input_p99_ms",m.p99_us/1000.0},{"input_max_ms",m.max_us/1000.0}};
+        fprintf(stderr,"%-44s %8.1f bytes/tick (completa %zu) | entrada p50 %.1f ms p99 %.1f ms\n",
+                name.c_str(),per_tick,tmp.size(),m.p50_us/1000.0,m.p99_us/1000.0);
+        g_results.push_back(r);
+    }
+    TICK_US=saved;
+}
+
+// Terminal lenta: stdout es un pipe chico que otro hilo vacía a ~8 KB/s. Con
+// render en el tick cada frame frena la simulación; con hilo de render el tick
+// tiene que seguir en su período y los frames que no salen a tiempo se saltean.
+struct SlowReader { int fd; std::atomic<bool> stop{false}; uint64_t bytes=0; };
+static void* slow_reader_main(void* arg){
+    SlowReader* r=(SlowReader*)arg;
+    char buf[16];
+    while(!r->stop.load()){
+        ssize_t n=::read(r->fd,buf,sizeof buf);
+        if(n>0) r->bytes+=(uint64_t)n;
+        usleep(2000);
+    }
+    return nullptr;
+}
+
+static void bench_throttled(int ticks,int tick_us){
+    int saved_tick=TICK_US; TICK_US=tick_us;
+    int saved_fd=g_renderer.out_fd;
+    term::cached_cols=120; term::cached_rows=40; term::size_dirty=false;
+    for(bool threaded: {false,true}){
+        std::string name=std::string("render/throttled/")+(threaded? "thread" : "sync");
+        if(!wanted(name)) continue;
+        int pfd[2];
+        if(pipe2(pfd,O_CLOEXEC)!=0) continue;
+        fcntl(pfd[0],F_SETPIPE_SZ,4096);
+        fcntl(pfd[0],F_SETFL,O_NONBLOCK);
+        SlowReader rd; rd.fd=pfd[0];
+        pthread_t th; pthread_create(&th,nullptr,slow_reader_main,&rd);
+        g_renderer.out_fd=pfd[1];
+        g_renderer.invalidate(); g_renderer.reset_stats();
+
+        GameState s; s.lives=1<<30;
+        batch::RandomPolicy pol(4);
+        Session ss; ss.st=&s; ss.max_ticks=ticks; ss.render=true; ss.render_thread=threaded;
+        ss.input=[&](const GameState& g){ return pol.pick(g); };
+        // Período medido entre el primer y el último tick (sin el cierre del render)
+        uint64_t t_first=0, t_last=0;
+        ss.on_tick=[&](const SimState&){ t_last=now_ns(); if(!t_first) t_first=t_last; };
+        run_session(ss);
+        rd.stop=true; pthread_join(th,nullptr);
+        ::close(pfd[0]); ::close(pfd[1]);
+
+        TickLatency::Summary m=ss.latency.summary();
+        double per=s.tick_id>1? (double)(t_last-t_first)/(s.tick_id-1) : 0;
+        Result r; r.name=name; r.iters=(uint64_t)s.tick_id; r.ns_per_op=per;
+        r.extra={{"tick_us",(double)tick_us},{"period_ratio",per/(tick_us*1000.0)},{"frames",(double)g_renderer.frames},
+                 {"skipped",(double)(ss.frames_published-ss.frames_drawn)},{"lat_p99_us",m.p99_us},{"out_bytes",(double)rd.bytes}};
+        fprintf(stderr,"%-44s %12.1f ns/tick (x%.2f del período, %llu frames)\n",name.c_str(),per,
+                per/(tick_us*1000.0),(unsigned long long)g_renderer.frames);
+        g_results.push_back(r);
+    }
+    g_renderer.out_fd=saved_fd;
+    g_renderer.invalidate(); g_renderer.reset_stats();
+    TICK_US=saved_tick;
+}
+
+// Servidor multi-sesión: N partidas por socketpair en el mismo proceso. Un hilo
+// hace de todos los clientes (lee los frames y manda flechas al azar). Sin
+// período mide el techo (rondas seguidas); con 90 ms, el ritmo real del juego.
+struct ServerClients { std::vector<int> fds; std::atomic<bool> stop{false}; uint64_t bytes=0, keys=0; };
+static void* server_clients_main(void* arg){
+    ServerClients* c=(ServerClients*)arg;
+    int ep=epoll_create1(EPOLL_CLOEXEC);
+    for(size_t i=0;i<c->fds.size();i++){ epoll_event ev{}; ev.events=EPOLLIN; ev.data.u64=i; epoll_ctl(ep,EPOLL_CTL_ADD,c->fds[i],&ev); }
+    uint64_t rng=12345;
+    static const char* ARROWS[4]={"\x1b[A","\x1b[B","\x1b[C","\x1b[D"};
+    char buf[65536];
+    epoll_event evs[256];
+    while(!c->stop.load()){
+        int n=epoll_wait(ep,evs,256,1);
+        for(int i=0;i<n;i++){
+            ssize_t r;
+            while((r=recv(c->fds[evs[i].data.u64],buf,sizeof buf,MSG_DONTWAIT))>0) c->bytes+=(uint64_t)r;
+        }
+        for(int k=0;k<16;k++){
+            rng=rng*6364136223846793005ull+1442695040888963407ull;
+            uint64_t v=rng>>33;
+            if(send(c->fds[v%c->fds.size()],ARROWS[(v>>20)&3],3,MSG_DONTWAIT|MSG_NOSIGNAL)==3) c->keys++;
+        }
+    }
+    ::close(ep);
+    return nullptr;
+}
+
+static void bench_server(int sessions){
+    for(int tick_us: {0,90000}){
+        std::string name="server/"+std::to_string(sessions)+"/"+(tick_us? "tick"+std::to_string(tick_us/1000)+"ms" : std::string("max"));
+        if(!wanted(name)) continue;
+        server::Options o;
+        server::Server srv(o);
+        ServerClients cl;
+        for(int i=0;i<sessions;i++){
+            int sv[2];
+            if(socketpair(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0,sv)!=0){ fprintf(stderr,"%s: socketpair: %s\n",name.c_str(),strerror(errno)); break; }
+            server::Session* s=srv.add(sv[0]);
+            s->st.lives=1<<30;
+            cl.fds.push_back(sv[1]);
+        }
+        if(cl.fds.empty()) continue;
+        pthread_t th; pthread_create(&th,nullptr,server_clients_main,&cl);
+
+        int rounds= tick_us? 34 : 100;                  // ~3 s al ritmo del juego
+        TickClock clock(tick_us);
+        srv.round();                                    // frames completos iniciales, fuera de la medida
+        srv.latency.clear();
+        uint64_t ticks0=srv.session_ticks, t0=now_ns(), work_ns=0, worst_round=0;
+        for(int i=0;i<rounds;i++){
+            clock.wait();
+            srv.round();
+            work_ns+=srv.round_ns; worst_round=std::max(worst_round,srv.round_ns);
+        }
+        uint64_t dt=now_ns()-t0, ticks=srv.session_ticks-ticks0;
+        cl.stop=true; pthread_join(th,nullptr);
+        uint64_t skipped=0; for(auto& s: srv.sessions) skipped+=s->frames_skipped;
+        for(int fd: cl.fds) ::close(fd);
+
+        TickLatency::Summary m=srv.latency.summary();
+        double per_s= dt? ticks*1e9/dt : 0;
+        Result r; r.name=name; r.iters=ticks; r.ns_per_op= ticks? (double)work_ns/ticks : 0;
+        r.extra={{"sessions",(double)srv.sessions.size()},{"workers",(double)srv.workers()},{"tick_us",(double)tick_us},
+                 {"session_ticks_per_s",per_s},{"lat_p50_us",m.p50_us},{"lat_p99_us",m.p99_us},{"lat_max_us",m.max_us},
+                 {"round_max_ms",worst_round/1e6},{"overruns",(double)clock.overruns},{"frames_skipped",(double)skipped},
+                 {"stolen_tasks",(double)srv.tasks_stolen},{"bytes_per_tick",ticks? (double)cl.bytes/ticks : 0}};
+        fprintf(stderr,"%-44s %12.0f ticks/s | tick->frame p50 %.0f us p99 %.0f us | ronda máx %.1f ms\n",
+                name.c_str(),per_s,m.p50_us,m.p99_us,worst_round/1e6);
+        g_results.push_back(r);
+    }
+}
+
+// ============================================================================
+// JSON
+// ============================================================================
+static std::string json_str(const std::string& s){
+    std::string o="\"";
+    for(char c: s){ if(c=='"'||c=='\\') o.push_back('\\'); o.push_back(c); }
+    return o+"\"";
+}
+
+static void write_json(FILE* f){
+    utsname u{}; uname(&u);
+    fprintf(f,"{\n  \"suite\": \"pacman_bench\",\n  \"version\": 1,\n");
+    fprintf(f,"  \"time\": %lld,\n",(long long)time(nullptr));
+    fprintf(f,"  \"host\": {\"machine\": %s, \"release\": %s, \"cpus\": %ld},\n",
+            json_str(u.machine).c_str(),json_str(u.release).c_str(),sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(f,"  \"min_ms\": %.0f,\n  \"results\": [\n",g_min_ms);
+    for(size_t i=0;i<g_results.size();i++){
+        const Result& r=g_results[i];
+        fprintf(f,"    {\"name\": %s, \"iters\": %llu, \"ns_per_op\": %.2f",
+                json_str(r.name).c_str(),(unsigned long long)r.iters,r.ns_per_op);
+        for(auto& e: r.extra) fprintf(f,", %s: %.3f",json_str(e.first).c_str(),e.second);
+        fprintf(f,"}%s\n",i+1<g_results.size()? "," : "");
+    }
+    fprintf(f,"  ]\n}\n");
+}
+
+int main(int argc,char** argv){
+    std::string out;
+    long scores_max=1000000;
+    int sync_ticks=1000, sync_tick_us=1000;
+    int pool_ticks=2000;
+    int level_size=2000;
+    int net_ticks=60;
+    int server_sessions=1000;
+    for(int i=1;i<argc;i++){
+        std::string a=argv[i];
+        auto val=[&]()->std::string{ return (i+1<argc)? argv[++i] : std::string(); };
+        if(a=="--out") out=val();
+        else if(a=="--min-ms") g_min_ms=std::max(1.0,atof(val().c_str()));
+        else if(a=="--filter") g_filter=val();
+        else if(a=="--scores-max") scores_max=atol(val().c_str());
+        else if(a=="--sync-ticks") sync_ticks=std::max(0,atoi(val().c_str()));
+        else if(a=="--sync-tick-us") sync_tick_us=std::max(0,atoi(val().c_str()));
+        else if(a=="--pool-ticks") pool_ticks=std::max(0,atoi(val().c_str()));
+        else if(a=="--workers") GHOST_WORKERS=std::max(1,atoi(val().c_str()));
+        else if(a=="--level-size") level_size=std::min(32767,atoi(val().c_str()));
+        else if(a=="--net-ticks") net_ticks=std::max(0,atoi(val().c_str()));
+        else if(a=="--server-sessions") server_sessions=std::max(0,atoi(val().c_str()));
+        else{
+            fprintf(stderr,"uso: %s [--out FILE] [--min-ms N] [--filter TEXTO] [--scores-max N] "
+                           "[--sync-ticks N] [--sync-tick-us U] [--pool-ticks N] [--workers N] [--level-size N] [--net-ticks N] [--server-sessions N]\n",argv[0]);
+            return 2;
+        }
+    }
+    RNG_SEED=1;
+
+    bench_render(level_size);
+    bench_ai();
+    bench_graph();
+    bench_state();
+    bench_vecenv();
+    bench_agent();
+    bench_swarm(pool_ticks);
+    bench_prof();
+    bench_level(level_size);
+    bench_builtin();
+    bench_gen();
+    bench_scores(scores_max);
+    if(sync_ticks>0) bench_sync(sync_ticks,sync_tick_us);
+    if(sync_ticks>0) bench_throttled(200,5000);
+    if(net_ticks>0) bench_net(net_ticks);
+    if(server_sessions>0) bench_server(server_sessions);
+
+    if(out.empty()) write_json(stdout);
+    else{
+        FILE* f=fopen(out.c_str(),"w");
+        if(!f){ perror(out.c_str()); return 1; }
+        write_json(f); fclose(f);
+        fprintf(stderr,"resultados en %s\n",out.c_str());
+    }
+    return 0;
+}
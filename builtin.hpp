@@ -0,0 +1,136 @@
+#pragma once
+// Laberintos integrados: texto compilado a tablas en tiempo de compilación
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include "game.hpp"
+
+// ============================================================================
+// Laberintos integrados
+// ============================================================================
+// compile() hace en constexpr el parseo y las validaciones de Maze::parse_text
+// + Maze::build con el texto de un laberinto fijo: planos de bits ya con el
+// layout de BitPlane, puerta y casa, inicio de Pac-Man y solo las fichas
+// alcanzables. Un laberinto integrado inválido no compila (el error apunta a
+// la llamada a invalid() con el motivo). En ejecución se copian los planos sin
+// parsear ni hacer el flood fill; Maze::build sigue derivando distancias y
+// grafos de cruces como en cualquier nivel.
+namespace builtin {
+
+// No es constexpr a propósito: llamarla durante la evaluación constante es
+// un error de compilación. En ejecución aborta con el motivo.
+void invalid(const char* why);
+
+template<int W,int H>
+struct Tables {
+    static constexpr int STRIDE=(W+63)/64, WORDS=STRIDE*H;
+    uint64_t walls[WORDS]{}, doors[WORDS]{}, tokens0[WORDS]{}, power0[WORDS]{};
+    int tokens0_count=0;
+    int houseX=0, houseY=0, doorY=0, doorX1=0, doorX2=0;
+    int spawnX=-1, spawnY=-1;
+
+    static constexpr bool test(const uint64_t* p,int x,int y){ return (p[y*STRIDE+(x>>6)]>>(x&63))&1u; }
+    static constexpr void set(uint64_t* p,int x,int y){ p[y*STRIDE+(x>>6)]|=(uint64_t)1<<(x&63); }
+    constexpr bool solid(int x,int y) const { return test(walls,x,y) || test(doors,x,y); }
+};
+
+// Filas de igual largo (las cortas se rellenan con '\0' = vacío)
+template<int H,int N>
+constexpr Tables<N-1,H> compile(const char (&rows)[H][N]){
+    constexpr int W=N-1;
+    static_assert(W>=3 && H>=3,"laberinto demasiado chico");
+    using T=Tables<W,H>;
+    T t;
+    for(int y=0;y<H;y++) for(int x=0;x<W;x++){
+        switch(rows[y][x]){
+        case WALL:  T::set(t.walls,x,y); break;
+        case DOOR:  T::set(t.doors,x,y); break;
+        case TOKEN: T::set(t.tokens0,x,y); break;
+        case POWER: T::set(t.power0,x,y); break;
+        case 'S':   t.spawnX=x; t.spawnY=y; break;
+        case EMPTY: case '\0': break;
+        default:    invalid("carácter desconocido en el laberinto");
+        }
+    }
+
+    // Puerta: primer tramo horizontal de '-'; la casa queda justo debajo del centro
+    bool door=false;
+    for(int y=0;y<H && !door;y++) for(int x=0;x<W;x++) if(T::test(t.doors,x,y)){
+        int b=x;
+        while(b+1<W && T::test(t.doors,b+1,y)) b++;
+        t.doorY=y; t.doorX1=x; t.doorX2=b; t.houseX=(x+b)/2; t.houseY=y+1;
+        door=true; break;
+    }
+    if(!door) invalid("falta la puerta de la casa ('-')");
+    if(t.houseY>=H || t.solid(t.houseX,t.houseY)) invalid("la casa debe estar libre justo debajo de la puerta");
+
+    if(t.spawnX<0)
+        for(int y=0;y<H && t.spawnX<0;y++) for(int x=0;x<W;x++) if(!t.solid(x,y)){ t.spawnX=x; t.spawnY=y; break; }
+    if(t.spawnX<0 || t.solid(t.spawnX,t.spawnY)) invalid("el inicio de Pac-Man no es una celda libre");
+
+    // Fichas que cuentan: las alcanzables desde el inicio sin cruzar la
+    // puerta (BFS con túnel en los bordes, como flood_fill)
+    uint64_t reach[T::WORDS]{};
+    int q[W*H]{}, head=0, tail=0;
+    q[tail++]=t.spawnY*W+t.spawnX; T::set(reach,t.spawnX,t.spawnY);
+    while(head<tail){
+        int c=q[head++], x=c%W, y=c/W;
+        for(int d=0;d<4;d++){
+            int nx=(x+DIRS[d][0]+W)%W, ny=(y+DIRS[d][1]+H)%H;
+            if(t.solid(nx,ny) || T::test(reach,nx,ny)) continue;
+            T::set(reach,nx,ny); q[tail++]=ny*W+nx;
+        }
+    }
+    for(int i=0;i<T::WORDS;i++){
+        t.tokens0[i]&=reach[i]; t.power0[i]&=reach[i];
+        t.tokens0_count+=__builtin_popcountll(t.tokens0[i])+__builtin_popcountll(t.power0[i]);
+    }
+    if(t.tokens0_count==0) invalid("no hay fichas alcanzables");
+    return t;
+}
+
+// Los planos de un Maze a partir de las tablas (falta Maze::build con tokens_filtered)
+template<int W,int H>
+std::shared_ptr<Maze> to_maze(const Tables<W,H>& t){
+    auto m=std::make_shared<Maze>();
+    m->W=W; m->H=H;
+    BitPlane* dst[4]={&m->walls,&m->doors,&m->tokens0,&m->power0};
+    const uint64_t* src[4]={t.walls,t.doors,t.tokens0,t.power0};
+    for(int i=0;i<4;i++){ dst[i]->init(W,H); memcpy(dst[i]->w.data(),src[i],sizeof t.walls); }
+    m->spawnX=t.spawnX; m->spawnY=t.spawnY;
+    return m;
+}
+
+// Mapa estilo clásico (simétrico)
+inline constexpr char CLASSIC[][29]={
+"############################",
+"#............##............#",
+"#.####.#####.##.#####.####.#",
+"#P####.#####.##.#####.####P#",
+"#.####.#####.##.#####.####.#",
+"#..........................#",
+"#.####.##.########.##.####.#",
+"#......##....##....##......#",
+"######.#####.##.#####.######",
+"     #.#####.##.#####.#     ",
+"     #.##..      ..##.#     ",
+"     #.##.###--###.##.#     ",
+"######.##.#      #.##.######",
+"..........#      #..........",
+"######.##.#      #.##.######",
+"     #.##.########.##.#     ",
+"     #.##..........##.#     ",
+"     #.##.########.##.#     ",
+"######.##.########.##.######",
+"#............##............#",
+"#.####.#####.##.#####.####.#",
+"#P...#................#...P#",
+"####.#.##.########.##.#.####",
+"#......##....##....##......#",
+"#.##########.##.##########.#",
+"#..........................#",
+"############################"
+};
+inline constexpr auto CLASSIC_TABLES=compile(CLASSIC);
+
+} // namespace builtin
@@ -0,0 +1,159 @@
+#include "cast.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "term.hpp"
+
+namespace cast {
+
+namespace {
+constexpr size_t FLUSH_AT=64*1024;     // el escritor junta esto antes de un write()
+
+void* writer_main(void* arg){
+    Recorder* r=(Recorder*)arg;
+    std::string buf, frame;
+    while(true){
+        if(r->drain(buf,frame)) continue;
+        r->write_buf(buf);                   // anillo vacío: lo juntado va al disco
+        if(r->quit.load()){
+            if(r->drain(buf,frame)) continue;    // lo que entró entre medio
+            break;
+        }
+        // Dormir hasta que el render publique (avisa solo si sleeping está arriba)
+        r->sleeping.store(1);
+        if(r->head.load()==r->tail.load(std::memory_order_relaxed) && !r->quit.load()){
+            pollfd p{r->wake_fd,POLLIN,0};
+            if(poll(&p,1,100)>0){ uint64_t v; (void)!::read(r->wake_fd,&v,sizeof v); }
+        }
+        r->sleeping.store(0);
+    }
+    r->write_buf(buf);
+    return nullptr;
+}
+}
+
+void json_escape(std::string& out,const char* s,size_t n){
+    static const char HEX[]="0123456789abcdef";
+    for(size_t i=0;i<n;i++){
+        unsigned char c=(unsigned char)s[i];
+        switch(c){
+            case '"':  out+="\\\""; break;
+            case '\\': out+="\\\\"; break;
+            case '\n': out+="\\n"; break;
+            case '\r': out+="\\r"; break;
+            case '\t': out+="\\t"; break;
+            default:
+                if(c<0x20 || c==0x7f){ out+="\\u00"; out.push_back(HEX[c>>4]); out.push_back(HEX[c&15]); }
+                else out.push_back((char)c);
+        }
+    }
+}
+
+bool Recorder::open(const std::string& path,int cols,int rows,bool diff_frames,size_t ring_bytes,std::string* err){
+    close();
+    size_t cap=4096; while(cap<ring_bytes) cap<<=1;
+    ring.assign(cap,0); mask=cap-1;
+    head=0; tail=0; need_key=true; quit=false; sleeping=0;
+    frames=dropped=bytes_in=events=bytes_written=write_ns=0;
+    diff=diff_frames;
+
+    fd=::open(path.c_str(),O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0644);
+    if(fd<0){ if(err) *err=path+": "+strerror(errno); return false; }
+    std::string hd;
+    char b[160];
+    snprintf(b,sizeof b,"{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %lld, \"env\": {\"TERM\": \"",
+             cols,rows,(long long)time(nullptr));
+    hd=b;
+    const char* term=getenv("TERM"); if(!term) term="xterm-256color";
+    json_escape(hd,term,strlen(term));
+    hd+="\"}}\n";
+    write_buf(hd);
+    t0=now_ns();
+
+    wake_fd=eventfd(0,EFD_CLOEXEC|EFD_NONBLOCK);
+    running = wake_fd>=0 && pthread_create(&th,nullptr,writer_main,this)==0;
+    if(!running){
+        if(err) *err="no se pudo lanzar el escritor";
+        if(wake_fd>=0){ ::close(wake_fd); wake_fd=-1; }
+        ::close(fd); fd=-1; return false;
+    }
+    return true;
+}
+
+bool Recorder::frame(const char* p,size_t n){
+    if(fd<0 || n==0) return true;
+    uint64_t h=head.load(std::memory_order_relaxed);
+    uint64_t t=tail.load(std::memory_order_acquire);
+    size_t need=sizeof(Rec)+n;
+    frames.fetch_add(1,std::memory_order_relaxed);
+    if(need>ring.size()-(size_t)(h-t)){
+        dropped.fetch_add(1,std::memory_order_relaxed);
+        need_key.store(true,std::memory_order_relaxed);
+        return false;
+    }
+    Rec r{now_ns()-t0,(uint32_t)n};
+    auto put=[&](uint64_t pos,const void* src,size_t len){
+        size_t off=(size_t)(pos&mask), first=std::min(len,ring.size()-off);
+        memcpy(&ring[off],src,first);
+        memcpy(&ring[0],(const uint8_t*)src+first,len-first);
+    };
+    put(h,&r,sizeof r);
+    put(h+sizeof r,p,n);
+    head.store(h+need,std::memory_order_seq_cst);
+    need_key.store(false,std::memory_order_relaxed);
+    bytes_in.fetch_add(n,std::memory_order_relaxed);
+    if(sleeping.load(std::memory_order_seq_cst)){ uint64_t one=1; (void)!::write(wake_fd,&one,sizeof one); }
+    return true;
+}
+
+void Recorder::copy_out(uint64_t pos,void* dst,size_t n) const {
+    size_t off=(size_t)(pos&mask), first=std::min(n,ring.size()-off);
+    memcpy(dst,&ring[off],first);
+    memcpy((uint8_t*)dst+first,&ring[0],n-first);
+}
+
+// Un frame del anillo -> una línea de evento en buf (a disco cada FLUSH_AT)
+bool Recorder::drain(std::string& buf,std::string& frame){
+    uint64_t t=tail.load(std::memory_order_relaxed);
+    if(head.load(std::memory_order_acquire)==t) return false;
+    Rec r; copy_out(t,&r,sizeof r);
+    frame.resize(r.n);
+    copy_out(t+sizeof r,&frame[0],r.n);
+    tail.store(t+sizeof r+r.n,std::memory_order_release);
+
+    char ts[40];
+    snprintf(ts,sizeof ts,"[%.6f, \"o\", \"",r.t/1e9);
+    buf+=ts;
+    json_escape(buf,frame.data(),frame.size());
+    buf+="\"]\n";
+    events.fetch_add(1,std::memory_order_relaxed);
+    if(buf.size()>=FLUSH_AT) write_buf(buf);
+    return true;
+}
+
+void Recorder::write_buf(std::string& buf){
+    if(buf.empty() || fd<0) return;
+    uint64_t w0=now_ns();
+    term::write_all(fd,buf.data(),buf.size());
+    write_ns.fetch_add(now_ns()-w0,std::memory_order_relaxed);
+    bytes_written.fetch_add(buf.size(),std::memory_order_relaxed);
+    buf.clear();
+}
+
+void Recorder::close(){
+    if(running){
+        quit.store(true);
+        uint64_t one=1; (void)!::write(wake_fd,&one,sizeof one);
+        pthread_join(th,nullptr);
+        running=false;
+    }
+    if(wake_fd>=0){ ::close(wake_fd); wake_fd=-1; }
+    if(fd>=0){ ::close(fd); fd=-1; }
+}
+
+} // namespace cast
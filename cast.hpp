@@ -0,0 +1,64 @@
+#pragma once
+// Grabación de la sesión a asciicast v2 con un hilo escritor (sin I/O en el juego)
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <pthread.h>
+
+// ============================================================================
+// Grabación asciicast
+// ============================================================================
+// El render deja cada frame en un anillo de bytes (un productor, un consumidor:
+// solo contadores atómicos, nunca un mutex ni una syscall bloqueante) y un hilo
+// aparte lo escribe como eventos `[t, "o", "..."]`. Si el anillo no tiene lugar
+// el frame se descarta y se cuenta. Cada evento es un frame completo (se puede
+// cortar o buscar en cualquier punto) o, con diff, solo lo que cambió respecto
+// del anterior, como lo manda el render a la terminal; tras un descarte el
+// siguiente frame va completo para que la reproducción no quede corrida.
+namespace cast {
+
+constexpr size_t DEFAULT_RING=4u<<20;  // bytes (potencia de 2)
+
+struct Recorder {
+    // Configuración
+    bool diff=false;
+
+    // Contadores (frames/dropped/bytes_in los escribe el render; el resto el escritor)
+    std::atomic<uint64_t> frames{0}, dropped{0}, bytes_in{0};
+    std::atomic<uint64_t> events{0}, bytes_written{0}, write_ns{0};
+
+    ~Recorder(){ close(); }
+    // Crea el archivo, escribe la cabecera y lanza el escritor; false + err si falla
+    bool open(const std::string& path,int cols,int rows,bool diff_frames,size_t ring_bytes=DEFAULT_RING,std::string* err=nullptr);
+    bool active() const { return fd>=0; }
+    // ¿El próximo frame tiene que ir completo? (modo completo, inicio o descarte)
+    bool wants_full() const { return !diff || need_key.load(std::memory_order_relaxed); }
+    // Encola un frame (hilo del render). false = descartado por falta de lugar.
+    bool frame(const char* p,size_t n);
+    // Vacía lo pendiente, espera al escritor y cierra el archivo
+    void close();
+    double mb_per_s() const { uint64_t ns=write_ns.load(); return ns? bytes_written.load()*1e3/ns : 0.0; }
+
+    // Internos (los usa el hilo escritor)
+    struct Rec { uint64_t t; uint32_t n; };
+    std::vector<uint8_t> ring;
+    size_t mask=0;
+    alignas(64) std::atomic<uint64_t> head{0};     // bytes publicados (productor)
+    alignas(64) std::atomic<uint64_t> tail{0};     // bytes consumidos (escritor)
+    std::atomic<int> sleeping{0};
+    std::atomic<bool> need_key{true}, quit{false};
+    int fd=-1, wake_fd=-1;
+    uint64_t t0=0;
+    pthread_t th{};
+    bool running=false;
+
+    void copy_out(uint64_t pos,void* dst,size_t n) const;
+    bool drain(std::string& buf,std::string& frame);
+    void write_buf(std::string& buf);
+};
+
+// Anexa `s` como string JSON (sin comillas); ESC y demás controles como \u00XX
+void json_escape(std::string& out,const char* s,size_t n);
+
+} // namespace cast
@@ -0,0 +1,131 @@
+#include "coro.hpp"
+#include <poll.h>
+#include "prof.hpp"
+
+namespace coro {
+
+namespace {
+// Pac-Man: el mismo bucle que pacman_thread, con co_await donde estaba la barrera
+Proc pacman_proc(Game& g){
+    Session& ss=*g.ss;
+    GameState& s=*ss.st;
+    while(true){
+        co_await g.at(PH_INPUT);
+        TickInput in;
+        { prof::Scope sc(prof::INPUT); in=session_input(ss); }
+        g.t_in=now_ns();
+        tick_mark(ss,g.prev_tick,g.t_in);
+        if(session_over(ss) || in.quit){ s.stop=true; g.quit=true; co_return; }
+        apply_tick_input(s,in.k,in.bdx,in.bdy);
+        if(ss.rec) ss.rec->add(replay::encode(in.k,s.blinky_cmd_dx,s.blinky_cmd_dy));
+        begin_tick(s);
+
+        co_await g.at(PH_COLLIDE);     // los fantasmas ya dieron su paso
+        ss.latency.add(now_ns()-g.t_in);
+        { prof::Scope sc(prof::COLLIDE); handle_collisions(s); }
+        if(ss.on_tick) ss.on_tick(s);
+        if(session_over(ss)){ s.stop=true; co_return; }
+    }
+}
+
+// Un fantasma: espera el tick, da su paso y cede
+Proc ghost_proc(Game& g,int i){
+    Session& ss=*g.ss;
+    GameState& s=*ss.st;
+    while(true){
+        co_await g.at(PH_GHOSTS);
+        if(s.stop) co_return;
+        prof::Scope sc(prof::GHOST_AI);
+        ghost_step(s,i,ss.mode);
+    }
+}
+
+// Render en el mismo hilo, tras las colisiones (no hay fotos que pasar); el
+// tick que termina la partida también se dibuja, el de salida no
+Proc render_proc(Game& g){
+    Session& ss=*g.ss;
+    while(true){
+        co_await g.at(PH_RENDER);
+        if(g.quit) co_return;
+        session_render(ss);
+    }
+}
+}
+
+Game::Game(Session& s): ss(&s){
+    int n=s.st->gh.n;
+    for(auto& r: ready) r.reserve((size_t)n+1);
+    running.reserve((size_t)n+1);
+    procs.reserve((size_t)n+2);
+    procs.push_back(pacman_proc(*this));
+    for(int i=0;i<n;i++) procs.push_back(ghost_proc(*this,i));
+    if(s.render) procs.push_back(render_proc(*this));
+}
+
+Game::~Game(){
+    for(Proc& p: procs) if(p.h) p.h.destroy();
+}
+
+bool Game::tick(){
+    for(int p=0;p<PHASES;p++){
+        running.swap(ready[p]);         // lo que vuelva a esta fase va al tick siguiente
+        for(std::coroutine_handle<>& h: running) h.resume();
+        running.clear();
+    }
+    // Pac-Man manda: cuando termina, lo que quede suspendido se destruye con el Game
+    return !procs[0].h.done();
+}
+
+Game& Scheduler::add(Session& ss){
+    GameState& st=*ss.st;
+    st.stop=false; st.tick_id=0; st.ghosts_done=0;
+    st.blinky_cmd_dx=st.blinky_cmd_dy=0;
+    ss.mailbox=nullptr;
+    games.push_back(std::make_unique<Game>(ss));
+    return *games.back();
+}
+
+bool Scheduler::tick(){
+    size_t j=0;
+    for(size_t i=0;i<games.size();i++){
+        if(!games[i]->tick()) continue;             // terminada: se destruye abajo
+        if(j!=i) std::swap(games[j],games[i]);
+        j++;
+    }
+    games.resize(j);
+    ticks++;
+    return !games.empty();
+}
+
+void Scheduler::wait_until(uint64_t deadline){
+    prof::Scope sc(prof::SLEEP);
+    if(!keyboard){
+        if(deadline==0 || now_ns()>=deadline) return;
+        timespec ts{(time_t)(deadline/1000000000ull),(long)(deadline%1000000000ull)};
+        while(clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,nullptr)==EINTR) {}
+        return;
+    }
+    // Las teclas se leen apenas llegan (con su instante) hasta el deadline
+    while(keyboard){
+        uint64_t now=now_ns();
+        uint64_t left= deadline>now? deadline-now : 0;
+        timespec ts{(time_t)(left/1000000000ull),(long)(left%1000000000ull)};
+        pollfd p{STDIN_FILENO,POLLIN,0};
+        int r=ppoll(&p,1,&ts,nullptr);
+        if(r<0 && errno!=EINTR) break;
+        if(r>0){
+            if(!(p.revents&POLLIN) || !keyboard->read_from(STDIN_FILENO)) keyboard=nullptr;  // EOF/HUP
+            continue;
+        }
+        if(left==0 || r==0) break;
+    }
+    if(!keyboard) wait_until(deadline);     // stdin cerrado: queda solo el reloj
+}
+
+void Scheduler::run(int tick_us){
+    TickClock clk(tick_us);
+    do wait_until(clk.advance());
+    while(tick());
+}
+
+} // namespace coro
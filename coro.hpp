@@ -0,0 +1,81 @@
+#pragma once
+// Motor de partida con corrutinas C++20: un hilo, un planificador, sin barreras
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include "engine.hpp"
+
+// ============================================================================
+// Motor de corrutinas
+// ============================================================================
+// El tick es lockstep, así que los hilos de Pac-Man y de los fantasmas no
+// corren nunca a la vez: solo se pasan el turno por la barrera. Acá cada uno
+// es una corrutina con el mismo bucle que su hilo ("espero el tick, doy mi
+// paso, aviso") y el planificador las reanuda por fases en orden dentro de un
+// solo hilo del sistema: entrada de Pac-Man, un paso por fantasma, colisiones
+// y render. Esperar una fase posterior a la actual sigue en el mismo tick; una
+// igual o anterior, en el siguiente. Sin cambios de contexto del kernel ni
+// futex: se duerme una vez por tick (leyendo el teclado en la misma espera) y
+// un mismo hilo puede llevar muchas partidas.
+namespace coro {
+
+enum Phase { PH_INPUT=0, PH_GHOSTS, PH_COLLIDE, PH_RENDER, PHASES };
+
+// Corrutina de una partida: corre sola hasta su primer co_await y queda
+// suspendida al terminar para que Game la destruya
+struct Proc {
+    struct promise_type {
+        Proc get_return_object(){ return Proc{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void(){}
+        void unhandled_exception(){ std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> h;
+};
+
+// Una partida: sus corrutinas en listas por fase
+struct Game {
+    Session* ss=nullptr;
+    std::vector<std::coroutine_handle<>> ready[PHASES];
+    std::vector<std::coroutine_handle<>> running;     // la fase que se está reanudando
+    std::vector<Proc> procs;
+    uint64_t prev_tick=0, t_in=0;
+    bool quit=false;                    // salida en la fase de entrada (no se dibuja)
+
+    // co_await g.at(PH_x): seguir en esa fase
+    struct Await {
+        Game* g; Phase p;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h){ g->ready[p].push_back(h); }
+        void await_resume() const noexcept {}
+    };
+    Await at(Phase p){ return Await{this,p}; }
+
+    explicit Game(Session& s);
+    ~Game();
+    Game(const Game&)=delete;
+    Game& operator=(const Game&)=delete;
+
+    // Un tick: reanuda cada fase en orden. false = la partida terminó.
+    bool tick();
+};
+
+struct Scheduler {
+    std::vector<std::unique_ptr<Game>> games;
+    InputQueue* keyboard=nullptr;       // se llena leyendo stdin durante la espera del tick
+    uint64_t ticks=0;
+
+    // Prepara la sesión (estado en cero) y arranca sus corrutinas
+    Game& add(Session& ss);
+    // Un tick de todas las partidas; saca las terminadas. false = no queda ninguna.
+    bool tick();
+    // Ticks cada tick_us (0 = sin pausa) hasta que terminen todas
+    void run(int tick_us);
+    // Duerme hasta el deadline (0 = no duerme) atendiendo el teclado si hay
+    void wait_until(uint64_t deadline);
+};
+
+} // namespace coro
@@ -0,0 +1,344 @@
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include "engine.hpp"
+#include "render.hpp"
+#include "prof.hpp"
+#include "coro.hpp"
+
+int TICK_US=90000;
+uint64_t RNG_SEED=0;
+SyncKind TICK_SYNC=SYNC_BARRIER;
+bool PIN_THREADS=false;
+int GHOST_WORKERS=4;
+bool RENDER_THREAD=true;
+int RENDER_FPS=0;
+
+// ============================================================================
+// Cola de entrada
+// ============================================================================
+bool InputQueue::read_from(int fd){
+    ssize_t n=::read(fd,buf+have,sizeof(buf)-have);
+    if(n<0 && (errno==EINTR||errno==EAGAIN)) return true;
+    if(n<=0) return false;                                    // EOF
+    uint64_t t=now_ns();
+    have+=(size_t)n;
+    size_t used=keys::decode_all(buf,have,[&](keys::Key k){ push(k,t); });
+    memmove(buf,buf+used,have-used); have-=used;
+    return true;
+}
+
+static void* input_main(void* arg){
+    InputQueue* q=(InputQueue*)arg;
+    pollfd p[2]={{STDIN_FILENO,POLLIN,0},{q->wake_fd,POLLIN,0}};
+    while(true){
+        if(poll(p,2,-1)<0){ if(errno==EINTR) continue; break; }
+        if(p[1].revents) break;
+        if(p[0].revents&POLLIN){
+            if(!q->read_from(STDIN_FILENO)) break;
+        }else if(p[0].revents) break;                         // HUP/ERR
+    }
+    return nullptr;
+}
+
+void InputQueue::start(){
+    head=count=0; have=0;
+    wake_fd=eventfd(0,EFD_CLOEXEC);
+    running = wake_fd>=0 && pthread_create(&th,nullptr,input_main,this)==0;
+}
+
+void InputQueue::stop(){
+    if(running){
+        uint64_t one=1; (void)!::write(wake_fd,&one,sizeof(one));
+        pthread_join(th,nullptr);
+        running=false;
+    }
+    if(wake_fd>=0){ ::close(wake_fd); wake_fd=-1; }
+}
+
+// ============================================================================
+// Hilos
+// ============================================================================
+// Entrada del tick: una tecla del guion, o todo lo que llegó desde el tick
+// anterior (gana la última flecha para Pac-Man y la última WASD para Blinky)
+TickInput session_input(Session& ss){
+    TickInput in;
+    GameState& s=*ss.st;
+    if(ss.input){
+        in.k=ss.input(s);
+        in.quit=(in.k==keys::QUIT);
+        if(s.blinky_human) blinky_command(in.k,in.bdx,in.bdy);
+        if(ss.remote) ss.remote(in);
+        return in;
+    }
+    InputQueue::Event ev[InputQueue::CAP];
+    int n=ss.keyboard->drain(ev,InputQueue::CAP);
+    uint64_t t_pac=0, t_blinky=0;
+    for(int i=0;i<n;i++){
+        keys::Key k=ev[i].k;
+        if(k==keys::QUIT) in.quit=true;
+        else if(k==keys::UP||k==keys::DOWN||k==keys::LEFT||k==keys::RIGHT){ in.k=k; t_pac=ev[i].t; }
+        else if(s.blinky_human && blinky_command(k,in.bdx,in.bdy)) t_blinky=ev[i].t;
+    }
+    // Con piloto automático las flechas del teclado no cuentan
+    if(ss.pilot){ in.k=ss.pilot(s); t_pac=0; }
+    if(ss.remote) ss.remote(in);
+    // Latencia de las teclas que sí mueven algo en este tick
+    if(prof::enabled){
+        uint64_t now=now_ns();
+        if(t_pac) prof::add(prof::INPUT_LAG,now-t_pac);
+        if(t_blinky) prof::add(prof::INPUT_LAG,now-t_blinky);
+    }
+    return in;
+}
+bool session_over(const Session& ss){
+    return game_finished(*ss.st) || (ss.max_ticks>0 && ss.st->tick_id>=ss.max_ticks);
+}
+// Intervalo entre ticks y su desvío respecto de TICK_US
+void tick_mark(Session& ss,uint64_t& prev,uint64_t now){
+    if(prev){
+        uint64_t per=now-prev, want=(uint64_t)std::max(TICK_US,0)*1000;
+        uint64_t err=per>want? per-want : want-per;
+        ss.jitter.add(err);
+        if(prof::enabled){ prof::add(prof::TICK_PERIOD,per); prof::add(prof::JITTER,err); }
+    }
+    prev=now;
+}
+const char* sync_name(SyncKind k){
+    return k==SYNC_CONDVAR? "condvar" : k==SYNC_CORO? "corrutinas" : "barrera";
+}
+// Con hilo de render solo se publica la foto; si no, se dibuja acá mismo
+void session_render(Session& ss){
+    if(ss.mailbox){ ss.mailbox->publish(*ss.st); return; }
+    prof::Scope sc(prof::RENDER);
+    if(ss.prof_hud && (ss.st->tick_id&15)==0) g_renderer.hud=prof::hud_line();
+    render_locked(*ss.st);
+}
+
+// Hilo de render: dibuja la foto más nueva a su ritmo (cada foto publicada o
+// a lo sumo render_fps por segundo); las que se pisaron entre medio se saltean.
+// La terminal lenta frena este hilo, no el tick.
+static void* render_main(void* arg){
+    Session* ss=(Session*)arg;
+    FrameMailbox& mb=*ss->mailbox;
+    TickClock clk(ss->render_fps>0? 1000000/ss->render_fps : 0);
+    uint64_t drawn=0;
+    while(true){
+        int seen=mb.seq.load(std::memory_order_seq_cst);
+        bool quit=mb.quit.load();
+        if(mb.take()){
+            prof::Scope sc(prof::RENDER);
+            if(ss->prof_hud && (drawn&15)==0) g_renderer.hud=prof::hud_line();
+            render_locked(mb.latest());
+            drawn++;
+        }
+        if(quit) break;             // el último frame ya se tomó arriba
+        if(ss->render_fps>0) clk.wait();
+        mb.wait(seen);
+    }
+    return nullptr;
+}
+static void session_wait(TickClock& clk){
+    prof::Scope sc(prof::SLEEP);
+    clk.wait();
+}
+
+// --- Protocolo con barrera: A abre la fase de fantasmas, B la cierra ---------
+// Entre A y B solo corren los workers (cada uno escribe su tramo de fantasmas,
+// la ocupación es atómica y el resto del estado no cambia durante la fase), así
+// que no hace falta el mutex.
+void* pacman_thread(void* arg){
+    Session* ss=(Session*)arg;
+    GameState* s=ss->st;
+    if(ss->pin) tsync::pin_to_cpu(0);
+    TickClock clk(TICK_US);
+    uint64_t prev_tick=0;
+    while(true){
+        session_wait(clk);
+        TickInput in;
+        { prof::Scope sc(prof::INPUT); in=session_input(*ss); }
+        uint64_t t_in=now_ns();
+        tick_mark(*ss,prev_tick,t_in);
+
+        if(session_over(*ss) || in.quit){
+            s->stop=true;
+            ss->barrier.arrive_and_wait(); // libera a los fantasmas para que vean stop
+            break;
+        }
+        apply_tick_input(*s,in.k,in.bdx,in.bdy);
+        if(ss->rec) ss->rec->add(replay::encode(in.k,s->blinky_cmd_dx,s->blinky_cmd_dy));
+        begin_tick(*s);
+
+        {
+            prof::Scope sc(prof::TICK_WAIT);
+            ss->barrier.arrive_and_wait();     // A
+            ss->barrier.arrive_and_wait();     // B
+        }
+        ss->latency.add(now_ns()-t_in);
+
+        { prof::Scope sc(prof::COLLIDE); handle_collisions(*s); }
+        if(ss->on_tick) ss->on_tick(*s);
+        if(ss->render) session_render(*ss);
+
+        if(session_over(*ss)){ s->stop=true; ss->barrier.arrive_and_wait(); break; }
+    }
+    return nullptr;
+}
+
+void* ghost_worker(void* arg){
+    WorkerArgs* a=(WorkerArgs*)arg;
+    Session* ss=a->ss;
+    GameState* s=ss->st;
+    if(ss->pin) tsync::pin_to_cpu(a->cpu);
+    while(true){
+        ss->barrier.arrive_and_wait();     // A
+        if(s->stop) break;
+        { prof::Scope sc(prof::GHOST_AI); ghost_step_range(*s,a->begin,a->end,ss->mode); }
+        a->last_tick=s->tick_id;
+        ss->barrier.arrive_and_wait();     // B
+    }
+    return nullptr;
+}
+
+// --- Protocolo clásico con mutex + condition variables (para comparar) ------
+void* pacman_thread_cv(void* arg){
+    Session* ss=(Session*)arg;
+    GameState* s=ss->st;
+    if(ss->pin) tsync::pin_to_cpu(0);
+    TickClock clk(TICK_US);
+    uint64_t prev_tick=0;
+    while(true){
+        session_wait(clk);
+        TickInput in;
+        { prof::Scope sc(prof::INPUT); in=session_input(*ss); }
+        uint64_t t_in=now_ns();
+        tick_mark(*ss,prev_tick,t_in);
+
+        prof::lock(&s->mtx);
+        if(session_over(*ss) || in.quit){
+            s->stop=true;
+            pthread_cond_broadcast(&s->cond_tick); // despierta a los fantasmas para que salgan
+            prof::unlock(&s->mtx);
+            break;
+        }
+
+        apply_tick_input(*s,in.k,in.bdx,in.bdy);
+        if(ss->rec) ss->rec->add(replay::encode(in.k,s->blinky_cmd_dx,s->blinky_cmd_dy));
+
+        // Lanzar tick
+        s->ghosts_done=0;
+        begin_tick(*s);
+        pthread_cond_broadcast(&s->cond_tick);
+
+        // Esperar a TODOS los workers
+        while(!s->stop && s->ghosts_done < ss->workers)
+            prof::cond_wait(&s->cond_render,&s->mtx,prof::TICK_WAIT);
+        ss->latency.add(now_ns()-t_in);
+
+        // Colisiones + render
+        if(!s->stop){
+            { prof::Scope sc(prof::COLLIDE); handle_collisions(*s); }
+            if(ss->on_tick) ss->on_tick(*s);
+            if(ss->render) session_render(*ss);
+        }
+
+        bool finished=session_over(*ss);
+        if(finished){ s->stop=true; pthread_cond_broadcast(&s->cond_tick); }
+        prof::unlock(&s->mtx);
+
+        if(finished) break;
+    }
+    return nullptr;
+}
+
+void* ghost_worker_cv(void* arg){
+    WorkerArgs* a=(WorkerArgs*)arg;
+    Session* ss=a->ss;
+    GameState* s=ss->st;
+    if(ss->pin) tsync::pin_to_cpu(a->cpu);
+
+    while(true){
+        prof::lock(&s->mtx);
+        if(s->stop){ prof::unlock(&s->mtx); break; }
+
+        // Esperar nuevo tick
+        while(!s->stop && a->last_tick >= s->tick_id)
+            prof::cond_wait(&s->cond_tick,&s->mtx);
+        if(s->stop){ prof::unlock(&s->mtx); break; }
+
+        // Ejecutar un paso de su tramo de fantasmas
+        { prof::Scope sc(prof::GHOST_AI); ghost_step_range(*s,a->begin,a->end,ss->mode); }
+
+        // Marcar tick consumido
+        a->last_tick = s->tick_id;
+
+        // Contabilizar worker listo
+        s->ghosts_done++;
+        if(s->ghosts_done >= ss->workers)
+            pthread_cond_signal(&s->cond_render);
+
+        prof::unlock(&s->mtx);
+        if(TICK_US>0) usleep(TICK_US/2);
+    }
+
+    return nullptr;
+}
+
+void run_session(Session& ss){
+    GameState& st=*ss.st;
+    st.stop=false; st.tick_id=0; st.ghosts_done=0;
+    st.blinky_cmd_dx=st.blinky_cmd_dy=0;
+    ss.latency.clear(); ss.jitter.clear();
+    if(prof::enabled) prof::reset();
+
+    // Teclado: modo raw + hilo lector mientras dure la partida
+    keys::RawGuard rg(!ss.input);
+    InputQueue keyboard;
+    if(ss.sync==SYNC_CORO){
+        // Sin hilos: el planificador lee stdin mientras espera cada tick
+        if(!ss.input) ss.keyboard=&keyboard;
+        coro::Scheduler sch;
+        sch.keyboard=ss.keyboard;
+        sch.add(ss);
+        sch.run(TICK_US);
+        ss.keyboard=nullptr;
+        return;
+    }
+    if(!ss.input){ keyboard.start(); ss.keyboard=&keyboard; }
+
+    // Pool fijo de workers: cada uno avanza un tramo contiguo de fantasmas
+    if(ss.workers<1) ss.workers=1;
+    ss.barrier.init(ss.workers+1);
+    bool cv=(ss.sync==SYNC_CONDVAR);
+    pthread_t tpac;
+    std::vector<pthread_t> tw((size_t)ss.workers);
+    std::vector<WorkerArgs> args((size_t)ss.workers);
+    for(int k=0;k<ss.workers;k++){
+        int n=st.gh.n;
+        args[(size_t)k]=WorkerArgs{&ss,(int)((int64_t)n*k/ss.workers),(int)((int64_t)n*(k+1)/ss.workers),k+1,0};
+    }
+
+    // Hilo de render con sus tres fotos (del mismo laberinto: copiar no aloca)
+    std::unique_ptr<FrameMailbox> mailbox;
+    pthread_t trender{};
+    if(ss.render && ss.render_thread){
+        mailbox=std::make_unique<FrameMailbox>();
+        for(SimState& f: mailbox->slot) f=st;
+        ss.mailbox=mailbox.get();
+        pthread_create(&trender,nullptr,render_main,&ss);
+    }
+
+    pthread_create(&tpac, nullptr, cv? pacman_thread_cv : pacman_thread, &ss);
+    for(int k=0;k<ss.workers;k++)
+        pthread_create(&tw[(size_t)k], nullptr, cv? ghost_worker_cv : ghost_worker, &args[(size_t)k]);
+
+    pthread_join(tpac,nullptr);
+    for(pthread_t& th: tw) pthread_join(th,nullptr);
+    if(mailbox){
+        mailbox->stop();
+        pthread_join(trender,nullptr);
+        ss.frames_published=mailbox->published; ss.frames_drawn=mailbox->taken;
+        ss.mailbox=nullptr;
+    }
+    if(ss.keyboard){ keyboard.stop(); ss.keyboard=nullptr; }
+}
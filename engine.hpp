@@ -0,0 +1,267 @@
+#pragma once
+// Motor de partida: hilos de Pac-Man y fantasmas, protocolo de tick
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <climits>
+#include <cerrno>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "game.hpp"
+#include "replay.hpp"
+
+// ============================================================================
+// Barrera de fases (futex + sense reversal por generación)
+// ============================================================================
+namespace tsync {
+
+inline long futex(std::atomic<int>* addr,int op,int val){
+    static_assert(sizeof(std::atomic<int>)==sizeof(int),"futex necesita int plano");
+    return syscall(SYS_futex,reinterpret_cast<int*>(addr),op,val,nullptr,nullptr,0);
+}
+inline void cpu_relax(){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Barrera reutilizable: el último en llegar reinicia el contador y avanza la
+// generación; el resto gira un poco y luego duerme en el futex de la generación.
+struct PhaseBarrier {
+    alignas(64) std::atomic<int> remaining{0};
+    alignas(64) std::atomic<int> generation{0};
+    std::atomic<int> sleepers{0};
+    int parties=0, spin=0;
+
+    explicit PhaseBarrier(int n){
+        init(n);
+        spin = sysconf(_SC_NPROCESSORS_ONLN)>1 ? 4000 : 0; // en un solo núcleo girar no sirve
+    }
+    // Solo con la barrera quieta (antes de lanzar los hilos)
+    void init(int n){ parties=n; remaining.store(n); }
+    void arrive_and_wait(){
+        int gen=generation.load(std::memory_order_acquire);
+        if(remaining.fetch_sub(1,std::memory_order_acq_rel)==1){
+            remaining.store(parties,std::memory_order_relaxed);
+            generation.fetch_add(1,std::memory_order_seq_cst);
+            if(sleepers.load(std::memory_order_seq_cst)>0) futex(&generation,FUTEX_WAKE_PRIVATE,INT32_MAX);
+            return;
+        }
+        for(int i=0;i<spin;i++){
+            if(generation.load(std::memory_order_acquire)!=gen) return;
+            cpu_relax();
+        }
+        sleepers.fetch_add(1,std::memory_order_seq_cst);
+        while(generation.load(std::memory_order_seq_cst)==gen)
+            futex(&generation,FUTEX_WAIT_PRIVATE,gen);
+        sleepers.fetch_sub(1,std::memory_order_relaxed);
+    }
+};
+
+inline void pin_to_cpu(int cpu){
+    int n=(int)sysconf(_SC_NPROCESSORS_ONLN); if(n<1) n=1;
+    cpu_set_t set; CPU_ZERO(&set); CPU_SET(cpu%n,&set);
+    pthread_setaffinity_np(pthread_self(),sizeof(set),&set);
+}
+
+} // namespace tsync
+
+// Latencia de tick: desde que se obtiene la entrada hasta el fin de la fase de fantasmas
+struct TickLatency {
+    std::vector<uint32_t> ns;
+    void add(uint64_t v){ ns.push_back(v>UINT32_MAX? UINT32_MAX : (uint32_t)v); }
+    void clear(){ ns.clear(); }
+    struct Summary { size_t n=0; double mean_us=0, p50_us=0, p99_us=0, max_us=0; };
+    Summary summary() const {
+        Summary r; r.n=ns.size(); if(ns.empty()) return r;
+        std::vector<uint32_t> v=ns; std::sort(v.begin(),v.end());
+        double sum=0; for(uint32_t x: v) sum+=x;
+        r.mean_us=sum/v.size()/1000.0;
+        r.p50_us=v[(v.size()-1)/2]/1000.0;
+        r.p99_us=v[(size_t)((v.size()-1)*0.99)]/1000.0;
+        r.max_us=v.back()/1000.0;
+        return r;
+    }
+};
+
+// ============================================================================
+// Reloj de ticks y cola de entrada
+// ============================================================================
+// Paso fijo con deadline absoluto: el período no depende del trabajo del tick.
+// Si el tick se atrasa más de un período se reancla (sin ráfaga de ticks).
+struct TickClock {
+    uint64_t period=0, next=0, overruns=0;
+    explicit TickClock(int tick_us): period((uint64_t)std::max(tick_us,0)*1000) {}
+    // Deadline del tick que empieza (0 = sin espera) sin dormir; wait() duerme hasta él
+    uint64_t advance(){
+        if(period==0) return 0;
+        uint64_t now=now_ns();
+        if(next==0) next=now;
+        uint64_t d=next;
+        if(now>=next && now-next>period){ overruns++; next=d=now; }
+        next+=period;
+        return d;
+    }
+    void wait(){
+        uint64_t d=advance();
+        if(d==0 || now_ns()>=d) return;
+        timespec ts{(time_t)(d/1000000000ull),(long)(d%1000000000ull)};
+        while(clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,nullptr)==EINTR) {}
+    }
+};
+
+// Teclas leídas por un hilo propio (poll sobre stdin) con su instante de llegada.
+// Pac-Man vacía la cola al inicio de cada tick: nada se pierde entre ticks.
+struct InputQueue {
+    struct Event { keys::Key k; uint64_t t; };
+    static constexpr int CAP=256;
+    Event ring[CAP];
+    int head=0, count=0;
+    uint64_t dropped=0;                 // cola llena (no debería pasar)
+    pthread_mutex_t m=PTHREAD_MUTEX_INITIALIZER;
+    pthread_t th{};
+    int wake_fd=-1;
+    bool running=false;
+    unsigned char buf[64]; size_t have=0;   // secuencia de escape a medias
+
+    void push(keys::Key k,uint64_t t){
+        pthread_mutex_lock(&m);
+        if(count==CAP){ head=(head+1)%CAP; count--; dropped++; }
+        ring[(head+count)%CAP]={k,t}; count++;
+        pthread_mutex_unlock(&m);
+    }
+    // Copia y vacía lo pendiente; devuelve cuántos eventos dejó en out
+    int drain(Event* out,int max){
+        pthread_mutex_lock(&m);
+        int n=std::min(count,max);
+        int skip=count-n;               // si hay más que max, se quedan los más nuevos
+        for(int i=0;i<n;i++) out[i]=ring[(head+skip+i)%CAP];
+        head=(head+count)%CAP; count=0;
+        pthread_mutex_unlock(&m);
+        return n;
+    }
+    // Lee lo que haya en fd (listo para leer) y encola las teclas; false = EOF/error
+    bool read_from(int fd);
+    // Hilo lector propio (el motor de corrutinas lee stdin sin hilo, con read_from)
+    void start();
+    void stop();
+};
+
+// ============================================================================
+// Fotos para el hilo de render (triple buffer)
+// ============================================================================
+// La simulación copia el estado al buffer de atrás y lo intercambia con el del
+// medio (un exchange atómico, marcado como nuevo); el render intercambia el del
+// medio con el de adelante solo si hay uno nuevo y dibuja ese. Ninguno espera
+// al otro: si el render se atrasa, las fotos intermedias se pisan (saltadas).
+struct FrameMailbox {
+    static constexpr uint32_t FRESH=4;
+    SimState slot[3];
+    std::atomic<uint32_t> mid{1};       // índice del buffer del medio | FRESH
+    int back=0, front=2;                // de la simulación / del render
+    std::atomic<int> seq{0};            // fotos publicadas (el render duerme en este futex)
+    std::atomic<int> sleeping{0};
+    std::atomic<bool> quit{false};
+    uint64_t published=0, taken=0;
+
+    // Hilo de la simulación: copia (sin allocs tras la primera) y publica
+    void publish(const SimState& s){
+        slot[back]=s;
+        back=(int)(mid.exchange((uint32_t)back|FRESH,std::memory_order_acq_rel)&3);
+        published++;
+        seq.fetch_add(1,std::memory_order_seq_cst);
+        if(sleeping.load(std::memory_order_seq_cst)) tsync::futex(&seq,FUTEX_WAKE_PRIVATE,1);
+    }
+    // Hilo de render: true si hay una foto más nueva que la de adelante
+    bool take(){
+        if(!(mid.load(std::memory_order_acquire)&FRESH)) return false;
+        front=(int)(mid.exchange((uint32_t)front,std::memory_order_acq_rel)&3);
+        taken++;
+        return true;
+    }
+    const SimState& latest() const { return slot[front]; }
+    // Hilo de render: duerme hasta que se publique algo después de `seen`
+    void wait(int seen){
+        sleeping.store(1,std::memory_order_seq_cst);
+        while(seq.load(std::memory_order_seq_cst)==seen && !quit.load()) tsync::futex(&seq,FUTEX_WAIT_PRIVATE,seen);
+        sleeping.store(0,std::memory_order_relaxed);
+    }
+    void stop(){
+        quit.store(true);
+        seq.fetch_add(1,std::memory_order_seq_cst);
+        tsync::futex(&seq,FUTEX_WAKE_PRIVATE,1);
+    }
+};
+
+// Entrada ya resuelta para un tick
+struct TickInput {
+    keys::Key k=keys::NONE;     // tecla de Pac-Man (la última del tick)
+    int bdx=0, bdy=0;           // comando de Blinky (Modo 3)
+    bool quit=false;
+};
+
+// ============================================================================
+// Hilos y sincronización
+// ============================================================================
+extern int TICK_US;
+extern uint64_t RNG_SEED;
+
+enum SyncKind { SYNC_BARRIER=0, SYNC_CONDVAR=1, SYNC_CORO=2 };
+extern SyncKind TICK_SYNC;
+extern bool PIN_THREADS;
+extern int GHOST_WORKERS;   // hilos del pool de IA (--workers)
+extern bool RENDER_THREAD;  // dibujar en un hilo propio (--sync-render lo apaga)
+extern int RENDER_FPS;      // tope de frames por segundo del hilo de render (0 = cada foto)
+
+// Una partida en curso: estado + protocolo de tick + fuente de entrada
+struct Session {
+    GameState* st=nullptr;
+    GameMode mode=MODE_1;
+    SyncKind sync=SYNC_BARRIER;
+    bool pin=false;
+    int workers=GHOST_WORKERS;                         // pool fijo para la fase de fantasmas
+    bool render=true;
+    bool render_thread=RENDER_THREAD;                  // render en su hilo con fotos (si no, en el tick)
+    int render_fps=RENDER_FPS;
+    FrameMailbox* mailbox=nullptr;                     // la fija run_session si render_thread
+    bool prof_hud=false;                               // línea de perfil bajo el marcador
+    int max_ticks=0;                                   // 0 = sin límite
+    std::function<keys::Key(const GameState&)> input;  // vacío => teclado
+    std::function<keys::Key(const SimState&)> pilot;   // Pac-Man automático (el teclado sigue: q, WASD)
+    InputQueue* keyboard=nullptr;                      // la fija run_session si input está vacío
+    replay::Recorder* rec=nullptr;                     // entrada por tick (opcional)
+    std::function<void(TickInput&)> remote;            // entrada de otro jugador (red): Blinky
+    std::function<void(const SimState&)> on_tick;      // tras las colisiones de cada tick (red)
+    tsync::PhaseBarrier barrier{1};                    // workers+1, la ajusta run_session
+    TickLatency latency;
+    TickLatency jitter;                                // desvío de cada período respecto de TICK_US
+    uint64_t frames_published=0, frames_drawn=0;       // con hilo de render
+};
+
+// Piezas del tick compartidas por los motores (hilos y corrutinas)
+TickInput session_input(Session& ss);
+bool session_over(const Session& ss);
+void tick_mark(Session& ss,uint64_t& prev,uint64_t now);
+void session_render(Session& ss);
+const char* sync_name(SyncKind k);
+
+// Un worker del pool: avanza los fantasmas [begin,end) en cada tick
+struct WorkerArgs { Session* ss; int begin, end; int cpu; int last_tick; };
+
+// Protocolo con barrera (por defecto)
+void* pacman_thread(void* arg);
+void* ghost_worker(void* arg);
+// Protocolo clásico con mutex + condition variables (para comparar)
+void* pacman_thread_cv(void* arg);
+void* ghost_worker_cv(void* arg);
+
+// Monta Pac-Man + el pool de workers de una partida y espera a que terminen
+// (con SYNC_CORO, todo en el hilo que llama: ver coro.hpp)
+void run_session(Session& ss);
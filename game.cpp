@@ -0,0 +1,615 @@
+#include "game.hpp"
+#include "builtin.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+
+GhostNav GHOST_NAV=NAV_PATH;
+int GHOST_COUNT=DEFAULT_GHOSTS;
+bool GHOST_CORRIDORS=true;
+bool ZOBRIST_CHECK=false;
+
+// ============================================================================
+// Distancias reales en el laberinto
+// ============================================================================
+DistanceField::DistanceField(const BitPlane& walls,int sx,int sy){
+    W=walls.W; H=walls.H;
+    node_of.assign((size_t)W*H,-1);
+    // Componente alcanzable desde la casa
+    std::vector<int32_t> q; q.reserve((size_t)W*H);
+    auto open=[&](int x,int y){ return x>=0&&y>=0&&x<W&&y<H && !walls.test(x,y); };
+    if(open(sx,sy)){ node_of[(size_t)sy*W+sx]=0; q.push_back(sy*W+sx); }
+    for(size_t h=0;h<q.size();h++){
+        int c=q[h], x=c%W, y=c/W;
+        for(auto &d:DIRS){
+            int nx=x+d[0], ny=y+d[1];
+            if(!open(nx,ny) || node_of[(size_t)ny*W+nx]>=0) continue;
+            node_of[(size_t)ny*W+nx]=0; q.push_back(ny*W+nx);
+        }
+    }
+    // Numerar nodos en orden de celdas
+    for(int c=0;c<W*H;c++) if(node_of[c]>=0){ node_of[c]=N++; cell_of.push_back(c); }
+
+    // Nodo más cercano para cualquier celda (BFS multi-fuente sobre toda la grilla)
+    nearest.assign((size_t)W*H,-1);
+    q.clear();
+    for(int n=0;n<N;n++){ nearest[cell_of[n]]=n; q.push_back(cell_of[n]); }
+    for(size_t h=0;h<q.size();h++){
+        int c=q[h], x=c%W, y=c/W;
+        for(auto &d:DIRS){
+            int nx=x+d[0], ny=y+d[1];
+            if(nx<0||ny<0||nx>=W||ny>=H) continue;
+            int nc=ny*W+nx;
+            if(nearest[nc]>=0) continue;
+            nearest[nc]=nearest[c]; q.push_back(nc);
+        }
+    }
+
+    if(N<=ALL_PAIRS_MAX){
+        all.assign((size_t)N*N,UNREACH);
+        std::vector<int32_t> bq; bq.reserve(N);
+        for(int t=0;t<N;t++) bfs(t,&all[(size_t)t*N],bq);
+    }
+}
+
+void DistanceField::bfs(int target,uint16_t* out,std::vector<int32_t>& q) const{
+    std::fill(out,out+N,UNREACH);
+    q.clear(); q.push_back(target); out[target]=0;
+    for(size_t h=0;h<q.size();h++){
+        int n=q[h], c=cell_of[n], x=c%W, y=c/W;
+        uint16_t nd = out[n]>=UNREACH-1 ? (uint16_t)(UNREACH-1) : (uint16_t)(out[n]+1);
+        for(auto &d:DIRS){
+            int nx=x+d[0], ny=y+d[1];
+            if(nx<0||ny<0||nx>=W||ny>=H) continue;
+            int m=node_of[(size_t)ny*W+nx];
+            if(m<0 || out[m]!=UNREACH) continue;
+            out[m]=nd; q.push_back(m);
+        }
+    }
+}
+
+// ============================================================================
+// Grafo de cruces
+// ============================================================================
+JunctionGraph::JunctionGraph(const BitPlane& walls,const BitPlane* doors,bool wrap_): W(walls.W), H(walls.H), wrap(wrap_){
+    size_t n=(size_t)W*H;
+    auto closed=[&](int x,int y){ return walls.test(x,y) || (doors && doors->test(x,y)); };
+    // Vecino en la dirección d (-1 si sale del tablero sin túnel)
+    auto step=[&](int c,int d){
+        int x=c%W+DIRS[d][0], y=c/W+DIRS[d][1];
+        if(wrap){ x=(x+W)%W; y=(y+H)%H; }
+        else if(x<0||y<0||x>=W||y>=H) return -1;
+        return y*W+x;
+    };
+    open.assign(n,0);
+    at.assign(n,-1);
+    along.assign(n,-1);
+    constexpr int32_t PENDING=INT32_MIN;    // celda de pasillo todavía sin arista
+    for(int y=0;y<H;y++) for(int x=0;x<W;x++){
+        if(closed(x,y)) continue;
+        int c=y*W+x; uint8_t m=0;
+        for(int d=0;d<4;d++){ int o=step(c,d); if(o>=0 && !closed(o%W,o/W)) m|=(uint8_t)(1u<<d); }
+        open[(size_t)c]=m;
+        at[(size_t)c]=PENDING;
+    }
+    auto add_node=[&](int c){
+        at[(size_t)c]=(int32_t)nodes.size();
+        nodes.push_back(Node{c,{-1,-1,-1,-1}});
+    };
+    for(size_t c=0;c<n;c++) if(at[c]==PENDING && __builtin_popcount(open[c])!=2) add_node((int)c);
+
+    // Cada salida de cada nodo recorre su pasillo hasta el nodo del otro lado
+    auto walk=[&](int a,int da){
+        Edge e{a,-1,(uint8_t)da,0,0,(uint32_t)cells.size()};
+        int32_t id=(int32_t)edges.size();
+        int cur=step(nodes[(size_t)a].cell,da), d=da;
+        while(at[(size_t)cur]==PENDING){
+            at[(size_t)cur]=-2-id; along[(size_t)cur]=e.len; cells.push_back(cur); e.len++;
+            uint8_t m=open[(size_t)cur]&(uint8_t)~(1u<<dir_index(-DIRS[d][0],-DIRS[d][1]));
+            d=__builtin_ctz(m);
+            cur=step(cur,d);
+        }
+        e.b=at[(size_t)cur]; e.db=(uint8_t)dir_index(-DIRS[d][0],-DIRS[d][1]);
+        nodes[(size_t)a].edge[da]=id; nodes[(size_t)e.b].edge[e.db]=id;
+        edges.push_back(e);
+    };
+    auto walk_all=[&](size_t from){
+        for(size_t k=from;k<nodes.size();k++)
+            for(int d=0;d<4;d++) if((open[(size_t)nodes[k].cell]>>d&1) && nodes[k].edge[d]<0) walk((int)k,d);
+    };
+    walk_all(0);
+    // Ciclos sin cruces: un nodo cualquiera en el ciclo
+    for(size_t c=0;c<n;c++) if(at[c]==PENDING){ size_t k=nodes.size(); add_node((int)c); walk_all(k); }
+}
+
+const uint32_t* JunctionGraph::pair_table() const{
+    size_t K=nodes.size();
+    if(K>PAIRS_MAX) return nullptr;
+    std::call_once(pairs_once,[&]{
+        // Adyacencia plana (vecino, largo+1) y Dijkstra desde cada cruce; con
+        // pesos enteros alcanza una cola de baldes circular de largo máximo+1
+        std::vector<uint32_t> off(K+1,0);
+        std::vector<std::pair<int32_t,uint32_t>> adj;
+        uint32_t R=1;
+        for(size_t v=0;v<K;v++){
+            for(int k=0;k<4;k++){
+                int32_t id=nodes[v].edge[k];
+                if(id<0) continue;
+                const Edge& ed=edges[(size_t)id];
+                int u= ed.a==(int)v && ed.da==k? ed.b : ed.a;
+                adj.push_back({u,(uint32_t)ed.len+1});
+                R=std::max(R,(uint32_t)ed.len+2);
+            }
+            off[v+1]=(uint32_t)adj.size();
+        }
+        pairs.assign(K*K,UNREACH);
+        std::vector<std::vector<int32_t>> ring(R);
+        for(size_t src=0;src<K;src++){
+            uint32_t* dist=&pairs[src*K];
+            dist[src]=0; ring[0].push_back((int32_t)src);
+            for(uint32_t d=0,pending=1;pending;d++){
+                std::vector<int32_t>& b=ring[d%R];
+                for(size_t j=0;j<b.size();j++){
+                    int v=b[j];
+                    if(dist[v]!=d) continue;
+                    for(uint32_t a=off[v];a<off[v+1];a++){
+                        auto [u,w]=adj[a];
+                        if(d+w<dist[u]){ dist[u]=d+w; ring[(d+w)%R].push_back(u); pending++; }
+                    }
+                }
+                pending-=(uint32_t)b.size(); b.clear();
+            }
+        }
+    });
+    return pairs.data();
+}
+
+int JunctionGraph::table_distance(int ca,int cb) const{
+    if(at[(size_t)ca]==-1 || at[(size_t)cb]==-1) return -1;
+    if(ca==cb) return 0;
+    Exit xa[2], xb[2]; int ea,ka,eb,kb;
+    int na=exits(ca,xa,ea,ka), nb=exits(cb,xb,eb,kb);
+    uint64_t best= ea>=0 && ea==eb? (uint64_t)std::abs(ka-kb) : UINT64_MAX;
+    const uint32_t* t=pair_table();
+    size_t K=nodes.size();
+    for(int i=0;i<na;i++) for(int j=0;j<nb;j++){
+        uint32_t d=t[(size_t)xa[i].node*K+(size_t)xb[j].node];
+        if(d!=UNREACH) best=std::min(best,(uint64_t)xa[i].cost+d+(uint64_t)xb[j].cost);
+    }
+    return best==UINT64_MAX? -1 : (int)best;
+}
+
+int JunctionGraph::distance(int ax,int ay,int bx,int by) const{
+    int ca=cell(ax,ay), cb=cell(bx,by);
+    if(at[(size_t)ca]==-1 || at[(size_t)cb]==-1) return -1;
+    if(ca==cb) return 0;
+    // Posición dentro de su arista y salidas (nodo, pasos) de cada extremo
+    Exit xa[2], xb[2]; int ea,ka,eb,kb;
+    int na=exits(ca,xa,ea,ka), nb=exits(cb,xb,eb,kb);
+    int best=INT32_MAX;
+    if(ea>=0 && ea==eb) best=std::abs(ka-kb);
+
+    std::vector<int> dist(nodes.size(),INT32_MAX);
+    typedef std::pair<int,int> QE;                  // (distancia, nodo)
+    std::priority_queue<QE,std::vector<QE>,std::greater<QE>> pq;
+    for(int i=0;i<na;i++) if(xa[i].cost<dist[(size_t)xa[i].node]){ dist[(size_t)xa[i].node]=xa[i].cost; pq.push({xa[i].cost,xa[i].node}); }
+    while(!pq.empty()){
+        auto [dn,v]=pq.top(); pq.pop();
+        if(dn>dist[(size_t)v] || dn>=best) continue;
+        for(int i=0;i<nb;i++) if(xb[i].node==v) best=std::min(best,dn+xb[i].cost);
+        for(int d=0;d<4;d++){
+            int32_t id=nodes[(size_t)v].edge[d];
+            if(id<0) continue;
+            const Edge& ed=edges[(size_t)id];
+            int u= ed.a==v && ed.da==d? ed.b : ed.a;
+            int nd=dn+ed.len+1;
+            if(nd<dist[(size_t)u]){ dist[(size_t)u]=nd; pq.push({nd,u}); }
+        }
+    }
+    return best==INT32_MAX? -1 : best;
+}
+
+// ============================================================================
+// Laberinto inmutable
+// ============================================================================
+// FNV-1a por palabras de 64 bits (los planos ya vienen alineados a palabra)
+static uint64_t fnv1a(uint64_t h,const uint64_t* p,size_t n){
+    for(size_t i=0;i<n;i++){ h^=p[i]; h*=0x100000001b3ull; h^=h>>29; }
+    return h;
+}
+
+// Relleno por tramos horizontales: cada tramo libre se marca de una vez con
+// máscaras de palabra y solo se apila un punto por tramo vecino de arriba/abajo,
+// así el costo depende de la cantidad de tramos y no de celdas. Con túnel.
+static int run_end(const BitPlane& p,int y,int x){       // última celda libre hacia la derecha
+    const uint64_t* row=&p.w[(size_t)y*p.stride];
+    for(;;){
+        uint64_t free_bits=~(row[x>>6]>>(x&63));
+        int n = free_bits? __builtin_ctzll(free_bits) : 64-(x&63);
+        if(n<64-(x&63) || x+n>=p.W) return std::min(x+n,p.W)-1;
+        x+=n;
+    }
+}
+static int run_begin(const BitPlane& p,int y,int x){     // primera celda libre hacia la izquierda
+    const uint64_t* row=&p.w[(size_t)y*p.stride];
+    for(;;){
+        uint64_t free_bits=~(row[x>>6]<<(63-(x&63)));
+        int n = free_bits? __builtin_clzll(free_bits) : (x&63)+1;
+        if(n<(x&63)+1 || x-n<0) return std::max(x-n+1,0);
+        x-=n;
+    }
+}
+static void set_span(BitPlane& p,int y,int x0,int x1){
+    uint64_t* row=&p.w[(size_t)y*p.stride];
+    for(int wi=x0>>6; wi<=(x1>>6); wi++){
+        int a=std::max(x0,wi*64)-wi*64, b=std::min(x1,wi*64+63)-wi*64;
+        row[wi] |= (~(uint64_t)0>>(63-b+a))<<a;
+    }
+}
+void flood_fill(const BitPlane& open,int sx,int sy,BitPlane& out){
+    int W=open.W, H=open.H;
+    out.init(W,H);
+    std::vector<std::pair<int,int>> st; st.reserve(1024);
+    st.push_back({sx,sy});
+    while(!st.empty()){
+        auto [x,y]=st.back(); st.pop_back();
+        if(!open.test(x,y) || out.test(x,y)) continue;
+        int x0=run_begin(open,y,x), x1=run_end(open,y,x);
+        set_span(out,y,x0,x1);
+        if(x0==0 && open.test(W-1,y)) st.push_back({W-1,y});
+        if(x1==W-1 && open.test(0,y)) st.push_back({0,y});
+        for(int ny: {(y+H-1)%H,(y+1)%H}){
+            const uint64_t* o=&open.w[(size_t)ny*open.stride];
+            const uint64_t* r=&out.w[(size_t)ny*out.stride];
+            for(int wi=x0>>6; wi<=(x1>>6); wi++){
+                int a=std::max(x0,wi*64)-wi*64, b=std::min(x1,wi*64+63)-wi*64;
+                uint64_t m=o[wi] & ~r[wi] & ((~(uint64_t)0>>(63-b+a))<<a);
+                while(m){
+                    int bit=__builtin_ctzll(m);
+                    st.push_back({wi*64+bit,ny});
+                    uint64_t t=~(m>>bit);               // salta el resto del tramo
+                    int len = t? __builtin_ctzll(t) : 64-bit;
+                    m &= len+bit>=64? 0 : ~(uint64_t)0<<(bit+len);
+                }
+            }
+        }
+    }
+}
+
+std::shared_ptr<const Maze> Maze::build(std::shared_ptr<Maze> m,std::string* err,bool tokens_filtered){
+    auto fail=[&](const std::string& e)->std::shared_ptr<const Maze>{ if(err) *err=e; return nullptr; };
+    int W=m->W, H=m->H;
+    if(W<3 || H<3) return fail("laberinto demasiado chico");
+    if(W>32767 || H>32767) return fail("laberinto demasiado grande (máx. 32767 por lado)");
+
+    // Puerta: primer tramo horizontal de '-'; la casa queda justo debajo del centro
+    bool door=false;
+    for(int y=0;y<H && !door;y++) for(int x=0;x<W;x++) if(m->doors.test(x,y)){
+        int b=x;
+        while(b+1<W && m->doors.test(b+1,y)) b++;
+        m->doorY=y; m->doorX1=x; m->doorX2=b; m->houseX=(x+b)/2; m->houseY=y+1;
+        door=true; break;
+    }
+    if(!door) return fail("falta la puerta de la casa ('-')");
+    if(m->houseY>=H || m->walls.test(m->houseX,m->houseY) || m->doors.test(m->houseX,m->houseY))
+        return fail("la casa debe estar libre justo debajo de la puerta");
+
+    auto solid=[&](int x,int y){ return m->walls.test(x,y) || m->doors.test(x,y); };
+    if(m->spawnX<0){
+        for(int y=0;y<H && m->spawnX<0;y++) for(int x=0;x<W;x++) if(!solid(x,y)){ m->spawnX=x; m->spawnY=y; break; }
+    }
+    if(m->spawnX<0 || m->spawnX>=W || m->spawnY<0 || m->spawnY>=H || solid(m->spawnX,m->spawnY))
+        return fail("el inicio de Pac-Man no es una celda libre");
+
+    // Fichas que cuentan: las alcanzables por Pac-Man (con túnel, sin cruzar la
+    // puerta). El resto (bolsillos cerrados, interior de la casa) se descarta.
+    // Un binario guardado por save_binary ya las trae filtradas.
+    if(!tokens_filtered){
+        BitPlane open=m->walls, reach;
+        for(size_t i=0;i<open.w.size();i++) open.w[i]=~(open.w[i]|m->doors.w[i]);
+        flood_fill(open,m->spawnX,m->spawnY,reach);
+        for(size_t i=0;i<reach.w.size();i++){ m->tokens0.w[i]&=reach.w[i]; m->power0.w[i]&=reach.w[i]; }
+    }
+    m->tokens0_count=m->tokens0.count()+m->power0.count();
+    if(m->tokens0_count==0) return fail("no hay fichas alcanzables");
+
+    // Identidad del nivel ya derivado (igual venga de texto o de binario)
+    uint64_t h=0xcbf29ce484222325ull;
+    uint64_t hdr[2]={(uint64_t)W<<32|(uint32_t)H,(uint64_t)(uint32_t)m->spawnX<<32|(uint32_t)m->spawnY};
+    h=fnv1a(h,hdr,2);
+    for(const BitPlane* p: {&m->walls,&m->doors,&m->tokens0,&m->power0}) h=fnv1a(h,p->w.data(),p->w.size());
+    m->hash=h;
+    m->ztokens0=zobrist::planes(m->tokens0,m->power0);
+
+    if((size_t)W*H<=DistanceField::MAX_CELLS)
+        m->dist=std::make_shared<const DistanceField>(m->walls,m->houseX,m->houseY);
+    // El atajo de pasillo de los fantasmas es exacto mientras cualquier distancia
+    // de step_towards (camino o FAR + euclídea) quede por debajo de su tope
+    if((size_t)W*H<=JunctionGraph::MAX_CELLS){
+        if((double)DistanceField::FAR+(double)(W-1)*(W-1)+(double)(H-1)*(H-1)<1e9)
+            m->ghost_graph=std::make_shared<const JunctionGraph>(m->walls,nullptr,false);
+        m->pac_graph=std::make_shared<const JunctionGraph>(m->walls,&m->doors,true);
+    }
+    return m;
+}
+
+std::shared_ptr<Maze> Maze::parse_text(const std::vector<std::string>& rows,std::string* err){
+    auto m=std::make_shared<Maze>();
+    std::vector<const std::string*> lines;
+    for(const std::string& r: rows) if(r.empty() || r[0]!=';') lines.push_back(&r);
+    while(!lines.empty() && lines.back()->empty()) lines.pop_back();
+    m->H=(int)lines.size();
+    for(const std::string* r: lines) m->W=std::max(m->W,(int)r->size());   // filas cortas = vacío
+    int W=m->W, H=m->H;
+    m->walls.init(W,H); m->doors.init(W,H); m->tokens0.init(W,H); m->power0.init(W,H);
+
+    for(int y=0;y<H;y++){
+        const std::string& r=*lines[(size_t)y];
+        for(int x=0;x<(int)r.size();x++){
+            switch(r[(size_t)x]){
+            case WALL:  m->walls.set(x,y); break;
+            case DOOR:  m->doors.set(x,y); break;
+            case TOKEN: m->tokens0.set(x,y); break;
+            case POWER: m->power0.set(x,y); break;
+            case 'S':   m->spawnX=x; m->spawnY=y; break;
+            case EMPTY: case '\r': break;
+            default:
+                if(err) *err="carácter desconocido '"+std::string(1,r[(size_t)x])+"' en fila "+std::to_string(y+1);
+                return nullptr;
+            }
+        }
+    }
+    return m;
+}
+
+std::shared_ptr<const Maze> Maze::from_text(const std::vector<std::string>& rows,std::string* err){
+    std::shared_ptr<Maze> m=parse_text(rows,err);
+    return m? build(m,err) : nullptr;
+}
+
+void builtin::invalid(const char* why){
+    fprintf(stderr,"laberinto integrado inválido: %s\n",why);
+    abort();
+}
+
+// Ya parseado y validado al compilar (builtin.hpp): solo se copian los planos
+// y se derivan distancias y grafos
+std::shared_ptr<const Maze> Maze::builtin(){
+    static const std::shared_ptr<const Maze> m = build(builtin::to_maze(builtin::CLASSIC_TABLES),nullptr,true);
+    return m;
+}
+
+bool Maze::path_tables() const{
+    return dist && (!dist->all.empty() || (ghost_graph && ghost_graph->pair_table()));
+}
+
+static std::shared_ptr<const Maze> g_current;
+static pthread_mutex_t g_current_mtx=PTHREAD_MUTEX_INITIALIZER;
+
+std::shared_ptr<const Maze> Maze::current(){
+    pthread_mutex_lock(&g_current_mtx);
+    std::shared_ptr<const Maze> m=g_current;
+    pthread_mutex_unlock(&g_current_mtx);
+    return m? m : builtin();
+}
+void Maze::set_current(std::shared_ptr<const Maze> m){
+    pthread_mutex_lock(&g_current_mtx);
+    g_current=std::move(m);
+    pthread_mutex_unlock(&g_current_mtx);
+}
+
+// ============================================================================
+// IA fantasmas
+// ============================================================================
+void compute_target(const SimState& s,int i,int &tx,int &ty){
+    if(s.power){
+        int cands[4][2]={{1,1},{s.W-2,1},{1,s.H-2},{s.W-2,s.H-2}};
+        int best=-1e9; tx=1; ty=1;
+        for(auto &c:cands){ int d=-dist2(c[0],c[1],s.px,s.py); if(d>best){best=d; tx=c[0]; ty=c[1];} }
+        return;
+    }
+    switch(s.gh.kind[i]){
+    case GHOST_BLINKY: tx=s.px; ty=s.py; return;
+    case GHOST_PINKY:  tx=s.px+s.pdx*4; ty=s.py+s.pdy*4; tx=std::max(0,std::min(s.W-1,tx)); ty=std::max(0,std::min(s.H-1,ty)); return;
+    case GHOST_INKY:{  int ix=s.px+2*s.pdx,iy=s.py+2*s.pdy; tx=2*ix-s.lead_x; ty=2*iy-s.lead_y; tx=std::max(0,std::min(s.W-1,tx)); ty=std::max(0,std::min(s.H-1,ty)); return; }
+    case GHOST_CLYDE:{ int d=dist2(s.gh.x[i],s.gh.y[i],s.px,s.py); if(d>64){ tx=s.px; ty=s.py; } else { tx=1; ty=s.H-2; } return; }
+    }
+    tx=s.px; ty=s.py;
+}
+void step_towards(SimState& s,int i,int tx,int ty){
+    // Distancia por camino (tabla de celdas o de cruces) si el laberinto tiene
+    // una; si no, euclídea. Sin camino: FAR + euclídea, nunca mejor que uno real
+    const uint16_t* row=nullptr;
+    const JunctionGraph* jg=nullptr;
+    int tcell=-1;
+    if(GHOST_NAV==NAV_PATH && s.dist){
+        int t=s.dist->nearest_node(tx,ty);
+        row=s.dist->from(t);
+        const JunctionGraph* g=s.maze->ghost_graph.get();
+        if(!row && t>=0 && g && g->pair_table()){ jg=g; tcell=s.dist->cell_of[(size_t)t]; }
+    }
+    Ghosts& g=s.gh;
+    int gx=g.x[i], gy=g.y[i], gdx=g.dx[i], gdy=g.dy[i];
+    int best=1e9,bdx=0,bdy=0;
+    for(auto &d:DIRS){
+        int ndx=d[0],ndy=d[1];
+        if(ndx==-gdx && ndy==-gdy) continue; // evita reversa inmediata
+        if(!can_move_ghost(s,i,ndx,ndy)) continue;
+        int nx=gx+ndx,ny=gy+ndy; s.wrap(nx,ny);
+        int dd=dist2(nx,ny,tx,ty);
+        if(row){
+            int n=s.dist->node(nx,ny);
+            if(n>=0 && row[n]!=DistanceField::UNREACH) dd=row[n];
+            else dd=DistanceField::FAR+dd;
+        }else if(jg){
+            int p=jg->table_distance(ny*s.W+nx,tcell);
+            dd= p>=0? p : DistanceField::FAR+dd;
+        }
+        if(dd<best){ best=dd; bdx=ndx; bdy=ndy; }
+    }
+    if(best==1e9){
+        if(can_move_ghost(s,i,-gdx,-gdy)){ bdx=-gdx; bdy=-gdy; }
+        else{
+            bool moved=false;
+            for(auto &d:DIRS) if(can_move_ghost(s,i,d[0],d[1])){ bdx=d[0]; bdy=d[1]; moved=true; break; }
+            if(!moved) return;
+        }
+    }
+    s.ghost_place(i,gx+bdx,gy+bdy); g.dx[i]=(int8_t)bdx; g.dy[i]=(int8_t)bdy;
+}
+void ghost_tick_ai(SimState& s,int i){
+    Ghosts& g=s.gh;
+    if(g.in_house[i]){
+        if(g.release[i]>0){ g.release[i]--; return; }
+        if(g.y[i]>s.doorY){
+            int ny=g.y[i]-1; if(!s.solid_for_ghost(g.x[i],ny)){ s.ghost_place(i,g.x[i],ny); return; }
+        }
+        s.ghost_leave_house(i); g.dx[i]=1; g.dy[i]=0;
+    }
+    // Pasillo: sin volver atrás hay una sola salida, la que elegiría step_towards
+    // sea cual sea el objetivo; solo en cruces y puntas se calcula
+    const JunctionGraph* jg=s.maze->ghost_graph.get();
+    if(GHOST_CORRIDORS && jg){
+        int d=jg->continuation(jg->cell(g.x[i],g.y[i]),g.dx[i],g.dy[i]);
+        if(d>=0){
+            s.ghost_place(i,g.x[i]+DIRS[d][0],g.y[i]+DIRS[d][1]);
+            g.dx[i]=(int8_t)DIRS[d][0]; g.dy[i]=(int8_t)DIRS[d][1];
+            return;
+        }
+    }
+    int tx=0,ty=0; compute_target(s,i,tx,ty); step_towards(s,i,tx,ty);
+}
+
+// ============================================================================
+// Colisiones
+// ============================================================================
+void handle_collisions(SimState& s){
+    // La grilla de ocupación descarta el caso común (nadie en la celda de Pac-Man)
+    // sin recorrer los fantasmas; solo si hay alguien se buscan cuáles son.
+    if(s.occ.any(s.px,s.py)){
+        Ghosts& g=s.gh;
+        for(int i=0;i<g.n;i++){
+            if(g.in_house[i] || g.x[i]!=s.px || g.y[i]!=s.py) continue;
+            if(s.power){
+                s.zhash^=s.z_score();
+                s.score+=200;
+                s.ghost_enter_house(i);
+                g.dx[i]=g.dy[i]=0; g.release[i]=5; // revive rápido
+                s.zhash^=s.z_score();
+                s.z_ghost_update(i);
+            }else{
+                s.zhash^=s.z_lives();
+                s.lives--;
+                s.px=s.maze->spawnX; s.py=s.maze->spawnY; s.pdx=1; s.pdy=0;
+                s.zhash^=s.z_lives();
+                s.z_pac_update();
+            }
+        }
+    }
+    if(s.power){
+        s.zhash^=s.z_power();
+        s.powerTimer--; if(s.powerTimer<=0) s.power=false;
+        s.zhash^=s.z_power();
+    }
+    if(ZOBRIST_CHECK) zobrist_verify(s);
+}
+
+// ============================================================================
+// Paso de simulación (compartido por los hilos y el modo batch)
+// ============================================================================
+void apply_tick_input(SimState& s,keys::Key k,int bdx,int bdy){
+    int dx=0,dy=0;
+    if(k==keys::LEFT) dx=-1;
+    if(k==keys::RIGHT) dx=+1;
+    if(k==keys::UP) dy=-1;
+    if(k==keys::DOWN) dy=+1;
+    if(dx||dy) move_pacman(s,dx,dy);
+
+    s.blinky_cmd_dx=bdx; s.blinky_cmd_dy=bdy;
+}
+
+bool blinky_command(keys::Key k,int& bdx,int& bdy){
+    if(k==keys::A){ bdx=-1; bdy=0; }
+    else if(k==keys::D){ bdx=+1; bdy=0; }
+    else if(k==keys::W){ bdx=0; bdy=-1; }
+    else if(k==keys::S){ bdx=0; bdy=+1; }
+    else return false;
+    return true;
+}
+
+void apply_input(SimState& s,keys::Key k){
+    int bdx=0,bdy=0;
+    if(s.blinky_human) blinky_command(k,bdx,bdy);
+    apply_tick_input(s,k,bdx,bdy);
+}
+
+static void ghost_move(SimState& s,int i,GameMode mode){
+    if(mode==MODE_3 && i==0 && !s.gh.in_house[0]){
+        int ddx=s.blinky_cmd_dx, ddy=s.blinky_cmd_dy;
+        if(ddx||ddy){
+            int nx=s.gh.x[0]+ddx, ny=s.gh.y[0]+ddy; s.wrap(nx,ny);
+            if(!s.solid_for_ghost(nx,ny)){ s.ghost_place(0,nx,ny); s.gh.dx[0]=(int8_t)ddx; s.gh.dy[0]=(int8_t)ddy; }
+            return;
+        }
+    }
+    ghost_tick_ai(s,i);
+}
+
+// Mueve [a,b) y devuelve el cambio de zhash del tramo (sin aplicarlo)
+static uint64_t ghost_range(SimState& s,int a,int b,GameMode mode){
+    uint64_t dz=0;
+    for(int i=a;i<b;i++){
+        ghost_move(s,i,mode);
+        uint64_t z=s.z_ghost(i);
+        dz^=s.gh.z[i]^z; s.gh.z[i]=z;
+    }
+    return dz;
+}
+
+void ghost_step(SimState& s,int i,GameMode mode){ ghost_step_range(s,i,i+1,mode); }
+
+void ghost_step_range(SimState& s,int a,int b,GameMode mode){
+    // Los workers corren en paralelo: un XOR atómico por tramo (conmuta)
+    uint64_t dz=ghost_range(s,a,b,mode);
+    if(dz) __atomic_fetch_xor(&s.zhash,dz,__ATOMIC_RELAXED);
+}
+
+// ============================================================================
+// Hash de Zobrist desde cero
+// ============================================================================
+uint64_t zobrist::planes(const BitPlane& dots,const BitPlane& pellets){
+    uint64_t z=0;
+    auto plane=[&](const BitPlane& p,Tag t){
+        for(int y=0;y<p.H;y++) for(int k=0;k<p.stride;k++){
+            uint64_t v=p.w[(size_t)y*p.stride+k];
+            while(v){ int x=k*64+__builtin_ctzll(v); v&=v-1; z^=key(t,(uint64_t)y*p.W+x); }
+        }
+    };
+    plane(dots,DOT); plane(pellets,PELLET);
+    return z;
+}
+
+uint64_t SimState::zobrist_full() const {
+    uint64_t z=zobrist::planes(dots,pellets)^z_pac()^z_power()^z_lives()^z_score();
+    for(int i=0;i<gh.n;i++) z^=z_ghost(i);
+    return z;
+}
+
+void zobrist_verify(const SimState& s){
+    uint64_t full=s.zobrist_full();
+    if(full==s.zhash) return;
+    fprintf(stderr,"zobrist: tick %d: hash incremental %016llx, desde cero %016llx\n",
+            s.tick_id,(unsigned long long)s.zhash,(unsigned long long)full);
+    abort();
+}
+
+void sim_tick_rest(SimState& s,GameMode mode){
+    begin_tick(s);
+    s.zhash^=ghost_range(s,0,s.gh.n,mode);
+    handle_collisions(s);
+}
+
+void sim_tick(SimState& s,keys::Key k,GameMode mode){
+    apply_input(s,k);
+    sim_tick_rest(s,mode);
+}
@@ -0,0 +1,479 @@
+#pragma once
+// Núcleo del juego: laberinto, estado, reglas y paso de simulación
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+#include <pthread.h>
+#include "term.hpp"
+
+// ============================================================================
+// Estado del juego
+// ============================================================================
+constexpr char WALL='#', TOKEN='.', POWER='P', EMPTY=' ', DOOR='-';
+constexpr int DIRS[4][2]={{0,-1},{-1,0},{0,1},{1,0}};
+// Índice en DIRS de un paso unitario (dx,dy)
+inline int dir_index(int dx,int dy){ return dy<0? 0 : dx<0? 1 : dy>0? 2 : 3; }
+
+enum GameMode { MODE_1=0, MODE_2=1, MODE_3=2 };
+
+// Comportamiento de cada fantasma (el fantasma i usa el tipo i%4)
+enum GhostKind : uint8_t { GHOST_BLINKY=0, GHOST_PINKY=1, GHOST_INKY=2, GHOST_CLYDE=3, NUM_GHOST_KINDS=4 };
+inline constexpr const char* GHOST_NAMES[NUM_GHOST_KINDS]={"Blinky","Pinky","Inky","Clyde"};
+inline constexpr uint8_t GHOST_COLORS[NUM_GHOST_KINDS]={31,35,36,33};   // rojo, rosa, cian, naranja
+constexpr int DEFAULT_GHOSTS=4;
+extern int GHOST_COUNT;     // fantasmas por partida (--ghosts)
+
+// ============================================================================
+// Planos de bits (paredes, puertas, fichas, power)
+// ============================================================================
+// Una fila ocupa `stride` palabras de 64 bits (filas alineadas a palabra), así
+// que las operaciones de máscara son bucles planos que el compilador vectoriza.
+struct BitPlane {
+    int W=0, H=0, stride=0;
+    std::vector<uint64_t> w;
+
+    void init(int w_,int h_){ W=w_; H=h_; stride=(W+63)/64; w.assign((size_t)stride*H,0); }
+    inline size_t idx(int x,int y) const { return (size_t)y*stride+(size_t)(x>>6); }
+    inline bool test(int x,int y) const { return (w[idx(x,y)]>>(x&63))&1u; }
+    inline void set(int x,int y){ w[idx(x,y)] |= (uint64_t)1<<(x&63); }
+    inline void reset(int x,int y){ w[idx(x,y)] &= ~((uint64_t)1<<(x&63)); }
+    // Apaga el bit y devuelve si estaba encendido
+    inline bool take(int x,int y){ uint64_t m=(uint64_t)1<<(x&63); uint64_t& v=w[idx(x,y)]; bool had=(v&m)!=0; v&=~m; return had; }
+
+    int count() const { int n=0; for(uint64_t v: w) n+=__builtin_popcountll(v); return n; }
+    void and_not(const BitPlane& o){ for(size_t i=0;i<w.size();i++) w[i]&=~o.w[i]; }
+    // Enciende el rectángulo [x0,x1]x[y0,y1] recortado al tablero
+    void set_rect(int x0,int y0,int x1,int y1){
+        x0=std::max(x0,0); y0=std::max(y0,0); x1=std::min(x1,W-1); y1=std::min(y1,H-1);
+        for(int y=y0;y<=y1;y++) for(int x=x0;x<=x1;x++) set(x,y);
+    }
+};
+// Celdas de `open` alcanzables desde (sx,sy), con túnel en los bordes
+void flood_fill(const BitPlane& open,int sx,int sy,BitPlane& out);
+
+// ============================================================================
+// Fantasmas: estructura de arreglos + ocupación por celda
+// ============================================================================
+// Una columna por campo: el paso de IA recorre rangos contiguos [a,b) y cada
+// worker toca solo su tramo de cada arreglo.
+struct Ghosts {
+    int n=0;
+    std::vector<int16_t> x, y;
+    std::vector<int8_t> dx, dy;
+    std::vector<uint8_t> kind;
+    std::vector<uint8_t> in_house;
+    std::vector<int32_t> release;       // ticks para salir de la casa
+    std::vector<uint64_t> z;            // clave de Zobrist vigente (SimState::z_ghost)
+
+    void resize(int k){
+        n=k;
+        x.assign((size_t)k,0); y.assign((size_t)k,0); dx.assign((size_t)k,0); dy.assign((size_t)k,0);
+        kind.assign((size_t)k,0); in_house.assign((size_t)k,1); release.assign((size_t)k,0);
+        z.assign((size_t)k,0);
+    }
+};
+
+// Cuántos fantasmas de cada tipo hay en cada celda (solo los que están fuera
+// de la casa, que son los que se dibujan y chocan). Se actualiza en cada
+// movimiento (atómico: los workers mueven fantasmas en paralelo); el render
+// y las colisiones consultan una celda en O(1) en vez de recorrer fantasmas.
+// Una palabra por celda con cuatro contadores de 16 bits (uno por tipo): como
+// hay a lo sumo MAX_GHOSTS fantasmas, ningún contador desborda al vecino.
+constexpr int MAX_GHOSTS=65535;
+struct Occupancy {
+    int W=0, H=0;
+    std::vector<uint64_t> cnt;          // (y*W)+x -> tipo k en los bits [16k,16k+16)
+
+    void init(int w,int h){ W=w; H=h; cnt.assign((size_t)W*H,0); }
+    inline uint64_t* at(int x,int y){ return &cnt[(size_t)y*W+x]; }
+    inline uint64_t get(int x,int y) const { return __atomic_load_n(&cnt[(size_t)y*W+x],__ATOMIC_RELAXED); }
+    inline void add(int x,int y,int k){ __atomic_fetch_add(at(x,y),(uint64_t)1<<(16*k),__ATOMIC_RELAXED); }
+    inline void sub(int x,int y,int k){ __atomic_fetch_sub(at(x,y),(uint64_t)1<<(16*k),__ATOMIC_RELAXED); }
+    inline uint32_t count(int x,int y,int k) const { return (uint32_t)(get(x,y)>>(16*k))&0xFFFF; }
+    // Primer tipo presente en la celda (prioridad Blinky > Pinky > Inky > Clyde) o -1
+    inline int top(int x,int y) const {
+        uint64_t c=get(x,y);
+        return c? __builtin_ctzll(c)/16 : -1;
+    }
+    inline bool any(int x,int y) const { return get(x,y)!=0; }
+};
+
+// ============================================================================
+// Distancias reales en el laberinto (para la IA de fantasmas)
+// ============================================================================
+// Nodos = celdas alcanzables por un fantasma desde la casa (sin paredes, sin
+// túnel: can_move_ghost no envuelve), construidas una vez por laberinto y
+// compartidas entre partidas. Hasta ALL_PAIRS_MAX nodos se guarda la tabla
+// completa N*N (uint16). Por encima, step_towards usa la tabla entre cruces del
+// grafo de los fantasmas (JunctionGraph::pair_table) más el desvío por el pasillo;
+// si el laberinto tiene demasiados cruces para esa tabla, los fantasmas navegan
+// por distancia euclídea: el costo por tick es siempre un par de lecturas, no
+// un BFS por objetivo.
+enum GhostNav { NAV_EUCLID=0, NAV_PATH=1 };
+extern GhostNav GHOST_NAV;
+
+struct DistanceField {
+    static constexpr uint16_t UNREACH=0xFFFF;
+    static constexpr int ALL_PAIRS_MAX=2048;
+    static constexpr size_t MAX_CELLS=(size_t)1<<20;
+    static constexpr int FAR=1<<24;                 // sin camino: mayor que cualquier distancia real
+
+    int W=0, H=0, N=0;
+    std::vector<int32_t> node_of;   // celda -> nodo (-1 si no es transitable/alcanzable)
+    std::vector<int32_t> cell_of;   // nodo -> celda
+    std::vector<int32_t> nearest;   // celda -> nodo más cercano (objetivos en pared o fuera)
+    std::vector<uint16_t> all;      // N*N o vacío
+
+    DistanceField(const BitPlane& walls,int sx,int sy);
+
+    void bfs(int target,uint16_t* out,std::vector<int32_t>& q) const;
+
+    inline int node(int x,int y) const { return (x<0||y<0||x>=W||y>=H)? -1 : node_of[(size_t)y*W+x]; }
+    inline int nearest_node(int x,int y) const {
+        x=std::max(0,std::min(W-1,x)); y=std::max(0,std::min(H-1,y));
+        return nearest[(size_t)y*W+x];
+    }
+
+    // Fila de distancias desde un nodo objetivo a todos los nodos (nullptr sin tabla completa)
+    inline const uint16_t* from(int target) const {
+        return target<0 || all.empty()? nullptr : &all[(size_t)target*N];
+    }
+};
+
+// ============================================================================
+// Grafo de cruces (pasillos comprimidos)
+// ============================================================================
+// Nodos = cruces (3 o más salidas) y puntas muertas; aristas = pasillos entre
+// dos nodos (celdas con exactamente dos salidas, rectas o con codo), con su
+// largo y sus celdas en orden. Uno para los fantasmas (sin paredes, sin túnel)
+// y otro para Pac-Man (sin paredes ni puerta, con túnel). En una celda de
+// pasillo quien no da la vuelta solo puede seguir: ahí los fantasmas no
+// calculan objetivo ni distancias y los rollouts del piloto no sortean.
+// Un ciclo sin cruces queda con un nodo arbitrario (grado 2) para no perderlo.
+extern bool GHOST_CORRIDORS;    // false = los fantasmas deciden en cada celda (--no-corridors)
+
+struct JunctionGraph {
+    static constexpr size_t MAX_CELLS=DistanceField::MAX_CELLS;
+    static constexpr size_t PAIRS_MAX=2048;     // cruces para la tabla K*K (16 MB como máximo)
+    static constexpr uint32_t UNREACH=0xFFFFFFFFu;
+
+    struct Node { int32_t cell; int32_t edge[4]; };  // arista que sale por cada dirección de DIRS (-1)
+    // a --(da)--> cells[first..first+len) --> b; db = dirección con la que se sale de b hacia la arista
+    struct Edge { int32_t a, b; uint8_t da, db; int32_t len; uint32_t first; };
+
+    int W=0, H=0;
+    bool wrap=false;
+    std::vector<uint8_t> open;      // celda -> bit d si se puede ir hacia DIRS[d]
+    std::vector<int32_t> at;        // celda -> nodo (>=0), arista (-2-e) o -1 (cerrada)
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    std::vector<int32_t> cells;     // celdas interiores de las aristas, en orden de a hacia b
+    std::vector<int32_t> along;     // celda de pasillo -> posición en su arista
+
+    // Cerradas: paredes (y puertas si se pasan); con wrap los bordes se unen (túnel)
+    JunctionGraph(const BitPlane& walls,const BitPlane* doors,bool wrap);
+
+    inline int cell(int x,int y) const { return y*W+x; }
+    inline bool corridor(int c) const { return at[(size_t)c]<=-2; }
+    // Única salida desde la celda c para quien viene moviéndose hacia (dx,dy)
+    // sin dar la vuelta (índice en DIRS); -1 si hay que decidir
+    inline int continuation(int c,int dx,int dy) const {
+        uint8_t m=open[(size_t)c];
+        if(dx||dy) m&=(uint8_t)~(1u<<dir_index(-dx,-dy));
+        return m && !(m&(m-1))? __builtin_ctz(m) : -1;
+    }
+    // Largo del camino más corto entre dos celdas abiertas (Dijkstra sobre los
+    // nodos con los extremos insertados en su arista); -1 si no hay camino
+    int distance(int ax,int ay,int bx,int by) const;
+    // Distancias entre cruces K*K; se arma la primera vez que se pide (un
+    // Dijkstra por cruce) y después es de solo lectura. nullptr si K > PAIRS_MAX
+    const uint32_t* pair_table() const;
+    // Lo mismo que distance() en O(1) con esa tabla: a lo sumo 2x2
+    // combinaciones de salidas. Solo si pair_table() no es nullptr
+    int table_distance(int ca,int cb) const;
+
+    // Salidas (nodo, pasos) de una celda abierta: 1 si es nodo, 2 si es de pasillo
+    struct Exit { int node, cost; };
+    inline int exits(int c,Exit out[2],int& e,int& k) const {
+        int w=at[(size_t)c];
+        if(w>=0){ out[0]={w,0}; e=-1; k=0; return 1; }
+        e=-2-w; k=along[(size_t)c];
+        const Edge& ed=edges[(size_t)e];
+        out[0]={ed.a,k+1}; out[1]={ed.b,ed.len-k};
+        return 2;
+    }
+
+private:
+    mutable std::once_flag pairs_once;
+    mutable std::vector<uint32_t> pairs;
+};
+
+// ============================================================================
+// Laberinto inmutable (compartido entre partidas)
+// ============================================================================
+// Texto: '#' pared, '.' ficha, 'P' power, '-' puerta, 'S' inicio de Pac-Man,
+// ' ' vacío; las líneas que empiezan con ';' son comentarios.
+// La puerta, la casa (bajo la puerta), el inicio (si no hay 'S', la primera
+// celda libre) y las fichas que cuentan (las alcanzables por Pac-Man) se derivan.
+struct Maze {
+    int W=0, H=0;
+    BitPlane walls, doors;          // estáticos
+    BitPlane tokens0, power0;       // estado inicial de fichas/power
+    int tokens0_count=0;
+    int houseX=0, houseY=0, doorY=0, doorX1=0, doorX2=0;
+    int spawnX=-1, spawnY=-1;       // inicio de Pac-Man (-1 = derivar)
+    std::shared_ptr<const DistanceField> dist;     // nullptr en laberintos enormes
+    // Grafos de cruces; nullptr en laberintos enormes (ver Maze::build)
+    std::shared_ptr<const JunctionGraph> ghost_graph, pac_graph;
+    std::string source;             // archivo de origen ("" = integrado)
+    uint64_t hash=0;                // FNV-1a de tamaño, inicio y planos ya derivados
+    uint64_t ztokens0=0;            // Zobrist de fichas/power iniciales (arranque sin recorrer planos)
+
+    // Completa lo derivado a partir de W/H y los cuatro planos. nullptr + err si no sirve.
+    // tokens_filtered: las fichas ya son solo las alcanzables (binario compilado).
+    static std::shared_ptr<const Maze> build(std::shared_ptr<Maze> m,std::string* err=nullptr,bool tokens_filtered=false);
+    // Solo los planos (sin derivar); nullptr + err ante un carácter desconocido
+    static std::shared_ptr<Maze> parse_text(const std::vector<std::string>& rows,std::string* err=nullptr);
+    static std::shared_ptr<const Maze> from_text(const std::vector<std::string>& rows,std::string* err=nullptr);
+
+    // Hay tabla para que NAV_PATH navegue por camino (de celdas o entre cruces,
+    // que se arma acá si falta); sin ella los fantasmas van por euclídea
+    bool path_tables() const;
+
+    // Mapa estilo clásico (simétrico), construido una sola vez
+    static std::shared_ptr<const Maze> builtin();
+    // Laberinto de las partidas nuevas (--level); por defecto el integrado
+    static std::shared_ptr<const Maze> current();
+    static void set_current(std::shared_ptr<const Maze> m);
+};
+
+// ============================================================================
+// Hash de Zobrist del estado
+// ============================================================================
+// XOR de una clave de 64 bits por rasgo presente: cada ficha y power vivos (por
+// celda), Pac-Man (celda y dirección), cada fantasma (índice, celda, dirección,
+// en casa y ticks para salir), power con su timer, vidas y puntaje. Cada regla
+// que cambia un rasgo saca su clave vieja y mete la nueva, así que mantenerlo
+// cuesta O(1) por cambio. Las claves salen de un mezclador sobre (rasgo, valor)
+// en vez de tablas: un nivel de 2000x2000 no necesita megas de claves al azar.
+// tick_id y la entrada no cuentan: el mismo estado en dos ticks distintos da el
+// mismo hash (es lo que quiere una tabla de transposición).
+extern bool ZOBRIST_CHECK;  // recalcular desde cero en cada tick y abortar si difiere (--zobrist-check)
+
+namespace zobrist {
+enum Tag : uint64_t { DOT=1, PELLET, PAC, GHOST, RELEASE, POWER, LIVES, SCORE };
+inline uint64_t key(Tag t,uint64_t v){
+    uint64_t z=((uint64_t)t<<56)^v;
+    z+=0x9E3779B97F4A7C15ull;
+    z=(z^(z>>30))*0xBF58476D1CE4E5B9ull; z=(z^(z>>27))*0x94D049BB133111EBull;
+    return z^(z>>31);
+}
+// Dirección empaquetada en 4 bits (dx+1, dy+1)
+inline uint64_t dir_bits(int dx,int dy){ return (uint64_t)((dx+1)|((dy+1)<<2)); }
+// Encadena el hash de un tick (checksum de una corrida: replays, batch)
+inline uint64_t chain(uint64_t c,uint64_t h){ return (c^h)*0x100000001b3ull; }
+// Claves de todas las fichas y power encendidos
+uint64_t planes(const BitPlane& dots,const BitPlane& pellets);
+} // namespace zobrist
+
+// ============================================================================
+// Estado de simulación (copiable) y estado de partida (con sincronización)
+// ============================================================================
+// SimState es solo datos: laberinto compartido e inmutable más lo que cambia
+// (planos de fichas vivos, Pac-Man, fantasmas, ocupación). Copiarlo es seguro y
+// asignarlo sobre otro del mismo laberinto reusa sus buffers (sin allocs): es
+// lo que clonan el buscador del piloto automático y los keyframes de replay.
+struct SimState {
+    std::shared_ptr<const Maze> maze;   // paredes/puertas/casa (inmutable)
+    BitPlane dots, pellets;             // fichas y power vivos
+    int H=0, W=0;
+
+    // Pac-Man
+    int px=1, py=1, pdx=1, pdy=0;
+    int lives=3;
+    int score=0;
+
+    // Comestibles
+    int tokens=0;
+    bool power=false;
+    int powerTimer=0;
+
+    // Control
+    bool stop=false;
+    int tick_id=0;
+
+    // Fantasmas (el 0 es Blinky: lo controla el humano en Modo 3 y guía a los Inky)
+    Ghosts gh;
+    Occupancy occ;
+    int lead_x=0, lead_y=0;   // Blinky al inicio del tick (lo usa Inky; fase de fantasmas sin orden)
+
+    // Casa
+    int houseX=0, houseY=0, doorY=0, doorX1=0, doorX2=0;
+
+    // Distancias reales (compartidas, inmutables)
+    std::shared_ptr<const DistanceField> dist;
+
+    // Modo 3 (Blinky humano)
+    bool blinky_human=false;
+    int blinky_cmd_dx=0, blinky_cmd_dy=0;
+
+    // Hash de Zobrist (lo mantienen las reglas; zobrist_full lo recalcula) y
+    // la clave vigente de Pac-Man (los fantasmas guardan la suya en gh.z)
+    uint64_t zhash=0, zpac=0;
+
+    SimState(): SimState(Maze::current(),GHOST_COUNT) {}
+    explicit SimState(std::shared_ptr<const Maze> m,int ghosts=DEFAULT_GHOSTS): maze(std::move(m)){
+        // Reset = copia de los planos iniciales (sin re-parsear el mapa)
+        const Maze& mz=*maze;
+        H=mz.H; W=mz.W;
+        dots=mz.tokens0; pellets=mz.power0; tokens=mz.tokens0_count;
+        houseX=mz.houseX; houseY=mz.houseY; doorY=mz.doorY; doorX1=mz.doorX1; doorX2=mz.doorX2;
+        dist=mz.dist;
+
+        // Pac-Man
+        px=mz.spawnX; py=mz.spawnY; pdx=1; pdy=0;
+
+        // Fantasmas con salida escalonada (respawn rápido): 5/25/45/65 para los
+        // cuatro clásicos; en enjambres cada vuelta de cuatro sale un tick después
+        gh.resize(std::max(ghosts,0));
+        occ.init(W,H);
+        for(int i=0;i<gh.n;i++){
+            gh.kind[i]=(uint8_t)(i%NUM_GHOST_KINDS);
+            gh.x[i]=(int16_t)houseX; gh.y[i]=(int16_t)houseY;
+            gh.release[i]=5+20*(i%NUM_GHOST_KINDS)+i/NUM_GHOST_KINDS;
+        }
+
+        power=false; powerTimer=0; stop=false;
+        zpac=z_pac();
+        zhash=mz.ztokens0^zpac^z_power()^z_lives()^z_score();
+        for(int i=0;i<gh.n;i++){ gh.z[i]=z_ghost(i); zhash^=gh.z[i]; }
+    }
+
+    inline void wrap(int &x,int &y) const { if(x<0)x=W-1; if(x>=W)x=0; if(y<0)y=H-1; if(y>=H)y=0; }
+    inline bool is_wall(int x,int y) const { return maze->walls.test(x,y); }
+    inline bool is_door(int x,int y) const { return maze->doors.test(x,y); }
+    inline bool solid_for_pacman(int x,int y) const { return is_wall(x,y)||is_door(x,y); }
+    inline bool solid_for_ghost (int x,int y) const { return is_wall(x,y); } // cruzan puerta
+    // Mueve el fantasma i manteniendo la ocupación al día
+    inline void ghost_place(int i,int nx,int ny){
+        bool out=!gh.in_house[i];
+        if(out) occ.sub(gh.x[i],gh.y[i],gh.kind[i]);
+        gh.x[i]=(int16_t)nx; gh.y[i]=(int16_t)ny;
+        if(out) occ.add(nx,ny,gh.kind[i]);
+    }
+    inline void ghost_leave_house(int i){ gh.in_house[i]=0; occ.add(gh.x[i],gh.y[i],gh.kind[i]); }
+    inline void ghost_enter_house(int i){
+        occ.sub(gh.x[i],gh.y[i],gh.kind[i]);
+        gh.in_house[i]=1; gh.x[i]=(int16_t)houseX; gh.y[i]=(int16_t)houseY;
+    }
+    // Claves de Zobrist de cada rasgo (x, y < 2^15: caben en el valor con el índice)
+    inline uint64_t z_cell(zobrist::Tag t,int x,int y) const { return zobrist::key(t,(uint64_t)y*W+x); }
+    inline uint64_t z_pac() const { return zobrist::key(zobrist::PAC,(uint64_t)px|(uint64_t)py<<15|zobrist::dir_bits(pdx,pdy)<<30); }
+    inline uint64_t z_ghost(int i) const {
+        uint64_t z=zobrist::key(zobrist::GHOST,(uint64_t)gh.x[i]|(uint64_t)gh.y[i]<<15|zobrist::dir_bits(gh.dx[i],gh.dy[i])<<30|
+                                                (uint64_t)gh.in_house[i]<<34|(uint64_t)i<<35);
+        if(gh.in_house[i] && gh.release[i]) z^=zobrist::key(zobrist::RELEASE,(uint64_t)i<<32|(uint32_t)gh.release[i]);
+        return z;
+    }
+    inline uint64_t z_power() const { return power? zobrist::key(zobrist::POWER,(uint32_t)powerTimer) : 0; }
+    inline uint64_t z_lives() const { return zobrist::key(zobrist::LIVES,(uint32_t)lives); }
+    inline uint64_t z_score() const { return zobrist::key(zobrist::SCORE,(uint32_t)score); }
+    // Tras mover a Pac-Man / cambiar el fantasma i: reemplaza su clave en zhash
+    inline void z_pac_update(){ uint64_t z=z_pac(); zhash^=zpac^z; zpac=z; }
+    inline void z_ghost_update(int i){ uint64_t z=z_ghost(i); zhash^=gh.z[i]^z; gh.z[i]=z; }
+    // Hash desde cero (O(fichas + fantasmas)); al día debe coincidir con zhash
+    uint64_t zobrist_full() const;
+
+    // Carácter vivo de la celda (para render): ficha, power, pared/puerta o vacío
+    inline char live_cell(int x,int y) const {
+        if(dots.test(x,y)) return TOKEN;
+        if(pellets.test(x,y)) return POWER;
+        if(is_wall(x,y)) return WALL;
+        if(is_door(x,y)) return DOOR;
+        return EMPTY;
+    }
+};
+
+// Partida en curso: la simulación más el mutex/condvars del protocolo de tick.
+// Copiar o asignar copia solo la simulación y las iniciales: las primitivas de
+// sincronización son siempre las propias (nunca se copia un mutex tomado).
+struct GameState : SimState {
+    std::string initials="";
+
+    // ---------- 🔒 SINCRONIZACIÓN ----------
+    pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;        // Mutex
+    pthread_cond_t  cond_tick   = PTHREAD_COND_INITIALIZER; // New tick
+    pthread_cond_t  cond_render = PTHREAD_COND_INITIALIZER; // Ghosts ready
+    int ghosts_done=0;        // workers que terminaron el tick (protocolo condvar)
+
+    GameState() {}
+    explicit GameState(std::shared_ptr<const Maze> m,int ghosts=DEFAULT_GHOSTS): SimState(std::move(m),ghosts) {}
+    GameState(const GameState& o): SimState(o), initials(o.initials) {}
+    GameState& operator=(const GameState& o){ SimState::operator=(o); initials=o.initials; return *this; }
+    GameState& operator=(const SimState& o){ SimState::operator=(o); return *this; }
+};
+
+// ============================================================================
+// Reglas (comer, mover, IA, colisiones) y paso de simulación
+// ============================================================================
+inline void eat_cell(SimState& s,int x,int y){
+    if(s.dots.take(x,y)){
+        s.zhash^=s.z_cell(zobrist::DOT,x,y)^s.z_score();
+        s.score+=10; s.tokens--;
+        s.zhash^=s.z_score();
+    }else if(s.pellets.take(x,y)){
+        s.zhash^=s.z_cell(zobrist::PELLET,x,y)^s.z_score()^s.z_power();
+        s.score+=50; s.tokens--; s.power=true; s.powerTimer=120; // power corto
+        s.zhash^=s.z_score()^s.z_power();
+    }
+}
+inline void move_pacman(SimState& s,int dx,int dy){
+    int nx=s.px+dx, ny=s.py+dy; s.wrap(nx,ny);
+    if(!s.solid_for_pacman(nx,ny)){
+        s.px=nx; s.py=ny; s.pdx=dx; s.pdy=dy;
+        s.z_pac_update();
+        eat_cell(s,nx,ny);
+    }
+}
+
+inline int dist2(int ax,int ay,int bx,int by){ int dx=ax-bx,dy=ay-by; return dx*dx+dy*dy; }
+inline bool can_move_ghost(const SimState& s,int i,int ndx,int ndy){
+    int nx=s.gh.x[i]+ndx,ny=s.gh.y[i]+ndy;
+    if(ny<0||ny>=s.H||nx<0||nx>=s.W) return false;
+    if(s.solid_for_ghost(nx,ny)) return false;
+    return true;
+}
+void compute_target(const SimState& s,int i,int &tx,int &ty);
+void step_towards(SimState& s,int i,int tx,int ty);
+void ghost_tick_ai(SimState& s,int i);
+void handle_collisions(SimState& s);
+
+inline bool game_finished(const SimState& s){ return s.stop||s.lives<=0||s.tokens<=0; }
+
+// Entrada de un tick ya decodificada: tecla de Pac-Man + comando de Blinky (Modo 3)
+void apply_tick_input(SimState& s,keys::Key k,int bdx,int bdy);
+// WASD -> comando de Blinky (Modo 3); false si la tecla no es de Blinky
+bool blinky_command(keys::Key k,int& bdx,int& bdy);
+// Entrada de un tick desde una tecla: Pac-Man con flechas, Blinky con WASD en Modo 3
+void apply_input(SimState& s,keys::Key k);
+// Un paso de un fantasma (IA o comando humano de Blinky en Modo 3)
+void ghost_step(SimState& s,int i,GameMode mode);
+// Fase de fantasmas para el rango [a,b): lo que corre cada worker. Junta el
+// cambio de hash de su tramo y lo aplica con un solo XOR atómico al final.
+void ghost_step_range(SimState& s,int a,int b,GameMode mode);
+// Recalcula el hash y aborta si no coincide con el incremental (ZOBRIST_CHECK)
+void zobrist_verify(const SimState& s);
+
+// Abre un tick: fija la foto de Blinky para que los fantasmas no dependan del orden
+inline void begin_tick(SimState& s){
+    if(s.gh.n>0){ s.lead_x=s.gh.x[0]; s.lead_y=s.gh.y[0]; }
+    s.tick_id++;
+}
+
+// Fase de fantasmas + colisiones en un solo hilo (la entrada ya está aplicada)
+void sim_tick_rest(SimState& s,GameMode mode);
+// Tick completo en un solo hilo: entrada, fantasmas y colisiones
+void sim_tick(SimState& s,keys::Key k,GameMode mode);
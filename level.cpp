@@ -0,0 +1,351 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "level.hpp"
+
+namespace level {
+
+namespace {
+// Archivo mapeado de solo lectura; se desmapea al salir del scope
+struct Mapped {
+    const uint8_t* p=nullptr; size_t n=0;
+    bool open(const std::string& path){
+        int fd=::open(path.c_str(),O_RDONLY|O_CLOEXEC);
+        if(fd<0) return false;
+        struct stat sb{};
+        if(fstat(fd,&sb)!=0){ ::close(fd); return false; }
+        n=(size_t)sb.st_size;
+        if(n>0){
+            void* m=mmap(nullptr,n,PROT_READ,MAP_PRIVATE,fd,0);
+            if(m==MAP_FAILED){ ::close(fd); n=0; return false; }
+            p=(const uint8_t*)m;
+        }
+        ::close(fd);
+        return true;
+    }
+    ~Mapped(){ if(p) munmap((void*)p,n); }
+};
+
+std::shared_ptr<const Maze> fail(std::string* err,const std::string& e){ if(err) *err=e; return nullptr; }
+}
+
+std::shared_ptr<const Maze> load_text(const std::string& path,std::string* err){
+    Mapped f;
+    if(!f.open(path)) return fail(err,"no se pudo abrir "+path);
+    std::vector<std::string> rows;
+    const char* s=(const char*)f.p; const char* end=s+f.n;
+    while(s<end){
+        const char* nl=(const char*)memchr(s,'\n',(size_t)(end-s));
+        const char* e= nl? nl : end;
+        rows.emplace_back(s,(size_t)(e-s));
+        s= nl? nl+1 : end;
+    }
+    std::shared_ptr<Maze> m=Maze::parse_text(rows,err);
+    if(!m) return nullptr;
+    m->source=path;
+    return Maze::build(m,err);
+}
+
+namespace {
+std::shared_ptr<const Maze> decode_as(const uint8_t* p,size_t n,const std::string& source,std::string* err){
+    if(n<sizeof(BinHeader)) return fail(err,"archivo de nivel truncado");
+    BinHeader hd; memcpy(&hd,p,sizeof hd);
+    if(memcmp(hd.magic,"PMLV",4)!=0 || hd.version!=1) return fail(err,"no es un nivel PMLV v1");
+    if(hd.W<3 || hd.H<3 || hd.W>32767 || hd.H>32767 || hd.stride!=(hd.W+63)/64)
+        return fail(err,"dimensiones inválidas");
+    size_t words=(size_t)hd.H*hd.stride;
+    if(n!=sizeof(BinHeader)+4*words*8) return fail(err,"tamaño de archivo inconsistente");
+
+    const uint64_t* pw=(const uint64_t*)(p+sizeof(BinHeader));
+    const uint64_t *walls=pw, *doors=pw+words, *tok=pw+2*words, *pow=pw+3*words;
+
+    // Una pasada: planos disjuntos y sin bits fuera del ancho
+    uint64_t tail = (hd.W%64)? (((uint64_t)1<<(hd.W%64))-1) : ~(uint64_t)0;
+    uint64_t bad=0;
+    for(size_t i=0;i<words;i++){
+        uint64_t w=walls[i], d=doors[i], t=tok[i], q=pow[i];
+        uint64_t valid = (i%hd.stride==hd.stride-1)? tail : ~(uint64_t)0;
+        bad |= (w&d) | ((t|q)&(w|d)) | (t&q) | ((w|d|t|q)&~valid);
+    }
+    if(bad) return fail(err,"planos superpuestos o bits fuera del tablero");
+
+    auto m=std::make_shared<Maze>();
+    m->W=(int)hd.W; m->H=(int)hd.H; m->spawnX=hd.spawn_x; m->spawnY=hd.spawn_y;
+    BitPlane* planes[4]={&m->walls,&m->doors,&m->tokens0,&m->power0};
+    for(int k=0;k<4;k++){
+        planes[k]->init(m->W,m->H);
+        memcpy(planes[k]->w.data(),pw+(size_t)k*words,words*8);
+    }
+    m->source=source;
+    return Maze::build(m,err,(hd.flags&FLAG_TOKENS_FILTERED)!=0);
+}
+}
+
+std::shared_ptr<const Maze> decode(const uint8_t* p,size_t n,std::string* err){ return decode_as(p,n,"",err); }
+
+std::shared_ptr<const Maze> load_binary(const std::string& path,std::string* err){
+    Mapped f;
+    if(!f.open(path)) return fail(err,"no se pudo abrir "+path);
+    return decode_as(f.p,f.n,path,err);
+}
+
+std::shared_ptr<const Maze> load(const std::string& path,std::string* err){
+    if(path.compare(0,4,"gen:")==0){
+        GenOptions o;
+        if(!parse_gen(path,o,err)) return nullptr;
+        return generate(o,err);
+    }
+    char magic[4]={0};
+    FILE* f=fopen(path.c_str(),"rb");
+    if(!f) return fail(err,"no se pudo abrir "+path);
+    size_t n=fread(magic,1,4,f); fclose(f);
+    if(n==4 && memcmp(magic,"PMLV",4)==0) return load_binary(path,err);
+    return load_text(path,err);
+}
+
+std::vector<uint8_t> encode(const Maze& m){
+    BinHeader hd{}; memcpy(hd.magic,"PMLV",4);
+    hd.version=1; hd.W=(uint32_t)m.W; hd.H=(uint32_t)m.H;
+    hd.spawn_x=m.spawnX; hd.spawn_y=m.spawnY; hd.stride=(uint32_t)m.walls.stride; hd.flags=FLAG_TOKENS_FILTERED;
+    std::vector<uint8_t> out(sizeof hd);
+    memcpy(out.data(),&hd,sizeof hd);
+    for(const BitPlane* p: {&m.walls,&m.doors,&m.tokens0,&m.power0}){
+        const uint8_t* b=(const uint8_t*)p->w.data();
+        out.insert(out.end(),b,b+p->w.size()*8);
+    }
+    return out;
+}
+
+bool save_binary(const Maze& m,const std::string& path){
+    std::vector<uint8_t> bin=encode(m);
+    FILE* f=fopen(path.c_str(),"wb");
+    if(!f) return false;
+    bool ok=fwrite(bin.data(),1,bin.size(),f)==bin.size();
+    return fclose(f)==0 && ok;
+}
+
+bool save_text(const Maze& m,const std::string& path){
+    FILE* f=fopen(path.c_str(),"w");
+    if(!f) return false;
+    // 'S' solo si el inicio no es el que se derivaría (la primera celda libre)
+    int fx=-1, fy=-1;
+    for(int y=0;y<m.H && fx<0;y++) for(int x=0;x<m.W;x++)
+        if(!m.walls.test(x,y) && !m.doors.test(x,y)){ fx=x; fy=y; break; }
+    bool mark_spawn = fx!=m.spawnX || fy!=m.spawnY;
+    std::string row((size_t)m.W,' ');
+    bool ok=true;
+    for(int y=0;y<m.H && ok;y++){
+        for(int x=0;x<m.W;x++){
+            char c=EMPTY;
+            if(m.walls.test(x,y)) c=WALL;
+            else if(m.doors.test(x,y)) c=DOOR;
+            else if(m.power0.test(x,y)) c=POWER;
+            else if(m.tokens0.test(x,y)) c=TOKEN;
+            if(mark_spawn && x==m.spawnX && y==m.spawnY) c='S';
+            row[(size_t)x]=c;
+        }
+        ok = fwrite(row.data(),1,row.size(),f)==row.size() && fputc('\n',f)!=EOF;
+    }
+    return fclose(f)==0 && ok;
+}
+
+// ============================================================================
+// Generador
+// ============================================================================
+namespace {
+struct GenRng {
+    uint64_t s;
+    uint64_t next(){
+        uint64_t z=(s+=0x9E3779B97F4A7C15ull);
+        z=(z^(z>>30))*0xBF58476D1CE4E5B9ull; z=(z^(z>>27))*0x94D049BB133111EBull;
+        return z^(z>>31);
+    }
+    uint32_t below(uint32_t n){ return (uint32_t)(((next()>>32)*(uint64_t)n)>>32); }
+};
+
+// Union-find con compresión por mitades
+struct UnionFind {
+    std::vector<int32_t> p;
+    explicit UnionFind(size_t n): p(n){ for(size_t i=0;i<n;i++) p[i]=(int32_t)i; }
+    int32_t find(int32_t a){ while(p[(size_t)a]!=a){ p[(size_t)a]=p[(size_t)p[(size_t)a]]; a=p[(size_t)a]; } return a; }
+    bool unite(int32_t a,int32_t b){ a=find(a); b=find(b); if(a==b) return false; p[(size_t)b]=a; return true; }
+};
+
+// Grilla de trabajo (ancho y alto impares)
+enum GenCell : uint8_t { G_WALL=0, G_DOT, G_DOOR, G_POWER, G_EMPTY };
+}
+
+std::shared_ptr<const Maze> generate(const GenOptions& o,std::string* err){
+    if(o.W<15 || o.H<15) return fail(err,"laberinto generado demasiado chico (mín. 15x15)");
+    if(o.W>32767 || o.H>32767 || (int64_t)o.W*o.H>((int64_t)1<<26)) return fail(err,"laberinto generado demasiado grande");
+    const int Wo=o.W-(o.W%2==0), Ho=o.H-(o.H%2==0);
+    const int cw=(Wo-1)/2, ch=(Ho-1)/2, hl=(cw+1)/2;   // celdas; hl = mitad izquierda (con la central)
+    GenRng rng{o.seed};
+    std::vector<uint8_t> g((size_t)Wo*Ho,G_WALL);
+    auto at=[&](int x,int y)->uint8_t&{ return g[(size_t)y*Wo+x]; };
+    auto open2=[&](int x,int y){ at(x,y)=G_DOT; at(Wo-1-x,y)=G_DOT; };
+
+    // Casa en el centro dentro de un anillo de pasillo sobre columnas/filas de celda
+    const int cx=cw, cy=(Ho/2)|1, R=(cx&1)? 4 : 5;
+    auto reserved=[&](int i,int j){ int x=2*i+1, y=2*j+1; return x>cx-R && x<cx+R && y>cy-4 && y<cy+4; };
+    auto on_ring=[&](int i,int j){ int x=2*i+1, y=2*j+1; return !reserved(i,j) && x>=cx-R && x<=cx+R && y>=cy-4 && y<=cy+4; };
+
+    // Kruskal en la mitad izquierda; el anillo ya es una sola componente
+    UnionFind uf((size_t)hl*ch);
+    auto id=[&](int i,int j){ return (int32_t)(j*hl+i); };
+    int32_t ring_root=-1;
+    for(int j=0;j<ch;j++) for(int i=0;i<hl;i++){
+        if(reserved(i,j)) continue;
+        open2(2*i+1,2*j+1);
+        if(on_ring(i,j)){ if(ring_root<0) ring_root=id(i,j); else uf.unite(ring_root,id(i,j)); }
+    }
+    for(int x=cx-R;x<=cx+R;x++){ at(x,cy-4)=G_DOT; at(x,cy+4)=G_DOT; }
+    for(int y=cy-4;y<=cy+4;y++){ at(cx-R,y)=G_DOT; at(cx+R,y)=G_DOT; }
+
+    struct Edge { int32_t a, b; int32_t x, y; };     // celdas y pared entre ellas
+    std::vector<Edge> edges; edges.reserve((size_t)hl*ch*2);
+    for(int j=0;j<ch;j++) for(int i=0;i<hl;i++){
+        if(reserved(i,j)) continue;
+        if(i+1<hl && !reserved(i+1,j) && !(on_ring(i,j) && on_ring(i+1,j))) edges.push_back({id(i,j),id(i+1,j),2*i+2,2*j+1});
+        else if(i+1==hl && cw%2==0) edges.push_back({id(i,j),id(i,j),2*i+2,2*j+1});  // cruce al espejo
+        if(j+1<ch && !reserved(i,j+1) && !(on_ring(i,j) && on_ring(i,j+1))) edges.push_back({id(i,j),id(i,j+1),2*i+1,2*j+2});
+    }
+    for(size_t k=edges.size();k>1;k--) std::swap(edges[k-1],edges[rng.below((uint32_t)k)]);
+    for(const Edge& e: edges){
+        // Con el espejo las dos mitades ya se tocan por el anillo: el cruce es solo un ciclo más
+        if(e.a!=e.b && uf.unite(e.a,e.b)) open2(e.x,e.y);
+        else if((int)rng.below(100)<o.loops) open2(e.x,e.y);
+    }
+
+    // Sin puntas muertas: cada celda con una sola salida abre otra hacia un vecino
+    if(!o.dead_ends){
+        for(int j=0;j<ch;j++) for(int i=0;i<hl;i++){
+            if(reserved(i,j)) continue;
+            int x=2*i+1, y=2*j+1, deg=0, cand[4][2], nc=0;
+            for(const auto& d: DIRS){
+                int ni=i+d[0], nj=j+d[1], wx=x+d[0], wy=y+d[1];
+                if(ni<0 || nj<0 || ni>=cw || nj>=ch || reserved(ni,nj)) continue;
+                if(at(wx,wy)!=G_WALL) deg++;
+                else { cand[nc][0]=wx; cand[nc][1]=wy; nc++; }
+            }
+            if(deg<=1 && nc>0){ int k=(int)rng.below((uint32_t)nc); open2(cand[k][0],cand[k][1]); }
+        }
+    }
+
+    // Túneles en filas de celda lejos de la casa
+    std::vector<int> rows;
+    for(int j=0;j<ch;j++){ int y=2*j+1; if(y<cy-4 || y>cy+4) rows.push_back(y); }
+    for(int t=0;t<o.tunnels && !rows.empty();t++){
+        size_t k=rng.below((uint32_t)rows.size());
+        open2(0,rows[k]);
+        rows[k]=rows.back(); rows.pop_back();
+    }
+
+    // Casa: caja con la puerta centrada arriba; adentro libre y sin fichas
+    for(int y=cy-3;y<=cy+3;y++) for(int x=cx-R+1;x<=cx+R-1;x++){
+        bool border= y==cy-3 || y==cy+3 || x==cx-R+1 || x==cx+R-1;
+        at(x,y)= border? G_WALL : G_EMPTY;
+    }
+    for(int x=cx-1;x<=cx+1;x++) at(x,cy-3)=G_DOOR;
+    // Inicio bajo el anillo, una columna a la derecha del centro. Es una
+    // elección empírica: la colisión solo cuenta si terminan el tick en la
+    // misma celda (cruzarse no choca), y desde el centro exacto la política
+    // aleatoria del batch casi nunca perdía una vida (se cruzaban). No es un
+    // invariante: Pac-Man quieto o un túnel con ancho impar cambian la paridad.
+    const int sx=cx+1, sy=cy+4;
+    at((o.W==Wo)? sx : cx,sy)=G_EMPTY;          // con ancho par es la copia de la central
+
+    // Power en pares simétricos: esquinas y luego celdas al azar (no en el anillo)
+    int pairs=std::max(o.pellets,0)/2;
+    int corner[2][2]={{1,1},{1,Ho-2}};
+    for(int k=0;k<pairs;k++){
+        int x,y;
+        if(k<2){ x=corner[k][0]; y=corner[k][1]; }
+        else{
+            int tries=0;
+            do{ x=2*(int)rng.below((uint32_t)(cw/2))+1; y=2*(int)rng.below((uint32_t)ch)+1; }
+            while((at(x,y)!=G_DOT || on_ring((x-1)/2,(y-1)/2)) && ++tries<64);
+            if(at(x,y)!=G_DOT || on_ring((x-1)/2,(y-1)/2)) continue;
+        }
+        at(x,y)=G_POWER; at(Wo-1-x,y)=G_POWER;
+    }
+
+    // Planos finales; un lado par duplica la columna central / la fila de la casa
+    auto m=std::make_shared<Maze>();
+    const int W=o.W, H=o.H;
+    m->W=W; m->H=H;
+    m->walls.init(W,H); m->doors.init(W,H); m->tokens0.init(W,H); m->power0.init(W,H);
+    auto mx=[&](int x){ return (W==Wo || x<=cx)? x : x-1; };
+    auto my=[&](int y){ return (H==Ho || y<=cy)? y : y-1; };
+    for(int y=0;y<H;y++){
+        const uint8_t* row=&g[(size_t)my(y)*Wo];
+        for(int x=0;x<W;x++){
+            switch(row[mx(x)]){
+            case G_WALL:  m->walls.set(x,y); break;
+            case G_DOOR:  m->doors.set(x,y); break;
+            case G_DOT:   m->tokens0.set(x,y); break;
+            case G_POWER: m->power0.set(x,y); break;
+            default: break;
+            }
+        }
+    }
+    m->spawnX=sx; m->spawnY=(H==Ho)? sy : sy+1;
+
+    // Validación: fichas alcanzables y, si corresponde, ninguna punta muerta
+    BitPlane open=m->walls, reach;
+    for(size_t i=0;i<open.w.size();i++) open.w[i]=~(open.w[i]|m->doors.w[i]);
+    flood_fill(open,m->spawnX,m->spawnY,reach);
+    for(size_t i=0;i<reach.w.size();i++)
+        if((m->tokens0.w[i]|m->power0.w[i])&~reach.w[i]) return fail(err,"generador: fichas inalcanzables (semilla "+std::to_string(o.seed)+")");
+    if(!o.dead_ends){
+        for(int y=0;y<H;y++) for(int x=0;x<W;x++){
+            if(!reach.test(x,y)) continue;
+            int deg=0;
+            for(const auto& d: DIRS){
+                int nx=(x+d[0]+W)%W, ny=(y+d[1]+H)%H;
+                deg+=open.test(nx,ny);
+            }
+            if(deg<2) return fail(err,"generador: punta muerta en "+std::to_string(x)+","+std::to_string(y));
+        }
+    }
+    m->source=gen_spec(o);
+    return Maze::build(m,err,true);
+}
+
+bool parse_gen(const std::string& spec,GenOptions& o,std::string* err){
+    std::string s= spec.compare(0,4,"gen:")==0? spec.substr(4) : spec;
+    size_t pos=0; bool size=false;
+    while(pos<=s.size()){
+        size_t e=s.find(':',pos); if(e==std::string::npos) e=s.size();
+        std::string t=s.substr(pos,e-pos);
+        pos=e+1;
+        if(t.empty()) continue;
+        int a=0, b=0; char c=0; unsigned long long n=0;
+        if(!size && sscanf(t.c_str(),"%dx%d%c",&a,&b,&c)==2){ o.W=a; o.H=b; size=true; }
+        else if(t=="ends") o.dead_ends=true;
+        else if(sscanf(t.c_str(),"loops=%d%c",&a,&c)==1) o.loops=std::max(0,std::min(100,a));
+        else if(sscanf(t.c_str(),"pellets=%d%c",&a,&c)==1) o.pellets=a;
+        else if(sscanf(t.c_str(),"tunnels=%d%c",&a,&c)==1) o.tunnels=a;
+        else if(sscanf(t.c_str(),"%llu%c",&n,&c)==1) o.seed=n;
+        else { if(err) *err="generador: no se entiende '"+t+"'"; return false; }
+    }
+    if(!size){ if(err) *err="generador: falta el tamaño (gen:ANCHOxALTO[:SEMILLA])"; return false; }
+    return true;
+}
+
+std::string gen_spec(const GenOptions& o){
+    GenOptions d;
+    std::string s="gen:"+std::to_string(o.W)+"x"+std::to_string(o.H)+":"+std::to_string(o.seed);
+    if(o.dead_ends) s+=":ends";
+    if(o.loops!=d.loops) s+=":loops="+std::to_string(o.loops);
+    if(o.pellets!=d.pellets) s+=":pellets="+std::to_string(o.pellets);
+    if(o.tunnels!=d.tunnels) s+=":tunnels="+std::to_string(o.tunnels);
+    return s;
+}
+
+} // namespace level
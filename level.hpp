@@ -0,0 +1,69 @@
+#pragma once
+// Niveles: archivo de texto para editar y forma binaria compacta (mmap)
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include "game.hpp"
+
+// ============================================================================
+// Niveles
+// ============================================================================
+// Binario "PMLV" v1: cabecera fija de 32 bytes y luego los planos de paredes,
+// puertas, fichas y power tal como los guarda BitPlane (H filas de `stride`
+// palabras de 64 bits, little endian). Se mapea con mmap, se valida en una sola
+// pasada sobre las cuatro columnas y se copia directo a los planos. Los que
+// escribe save_binary ya traen las fichas filtradas y se saltean ese relleno.
+namespace level {
+
+struct BinHeader {
+    char magic[4];          // "PMLV"
+    uint32_t version;       // 1
+    uint32_t W, H;
+    int32_t spawn_x, spawn_y;   // -1 = derivar
+    uint32_t stride;        // palabras de 64 bits por fila = (W+63)/64
+    uint32_t flags;         // FLAG_*
+};
+constexpr uint32_t FLAG_TOKENS_FILTERED=1;     // fichas ya recortadas a lo alcanzable
+static_assert(sizeof(BinHeader)==32,"cabecera de 32 bytes");
+
+// Carga texto, binario (según los primeros bytes) o "gen:..." (ver generate). nullptr + err si falla.
+std::shared_ptr<const Maze> load(const std::string& path,std::string* err=nullptr);
+std::shared_ptr<const Maze> load_text(const std::string& path,std::string* err=nullptr);
+std::shared_ptr<const Maze> load_binary(const std::string& path,std::string* err=nullptr);
+// Guarda los planos en binario (las fichas ya filtradas por alcance)
+bool save_binary(const Maze& m,const std::string& path);
+// El mismo binario en memoria (lo usa la red para mandar el nivel al cliente)
+std::vector<uint8_t> encode(const Maze& m);
+std::shared_ptr<const Maze> decode(const uint8_t* p,size_t n,std::string* err=nullptr);
+// Guarda en texto (para editar un nivel generado o convertido)
+bool save_text(const Maze& m,const std::string& path);
+
+// ============================================================================
+// Generador
+// ============================================================================
+// Laberinto simétrico (izquierda/derecha) al estilo Pac-Man: grilla de celdas
+// en coordenadas impares con paredes de una celda entre ellas. Un árbol por
+// Kruskal (union-find sobre aristas barajadas) en la mitad izquierda, espejado,
+// más un porcentaje de paredes abiertas para que haya ciclos. La casa va en el
+// centro con la puerta arriba (como la detecta Maze::build) dentro de un anillo
+// de pasillo; Pac-Man arranca bajo el anillo. Se valida al final: todas las
+// fichas alcanzables desde el inicio y, si no se piden puntas muertas, ninguna
+// celda de Pac-Man con una sola salida. Un ancho/alto par duplica la columna
+// central (y la fila de la casa). Misma semilla, mismo laberinto.
+struct GenOptions {
+    int W=28, H=31;             // mínimo 15x15
+    uint64_t seed=1;
+    bool dead_ends=false;       // permitirlas; si no, cada punta se abre hacia un vecino
+    int loops=15;               // % de las paredes internas sobrantes que se abren
+    int pellets=4;              // en pares simétricos: esquinas de arriba, de abajo y al azar
+    int tunnels=1;              // filas con túnel entre los bordes izquierdo y derecho
+};
+std::shared_ptr<const Maze> generate(const GenOptions& o,std::string* err=nullptr);
+// "gen:WxH[:SEED][:ends][:loops=N][:pellets=N][:tunnels=N]" (el prefijo es
+// opcional). load() acepta la misma forma; gen_spec es el Maze::source de un
+// laberinto generado, así un replay lo vuelve a generar.
+bool parse_gen(const std::string& spec,GenOptions& o,std::string* err=nullptr);
+std::string gen_spec(const GenOptions& o);
+
+} // namespace level
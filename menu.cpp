@@ -3,97 +3,26 @@
 #include <vector>
 #include <functional>
 #include <fstream>
-#include <pthread.h>
-#include <unistd.h>
-#include <termios.h>
-#include <sys/ioctl.h>
+#include <algorithm>
+#include <memory>
 #include <cstdlib>
+#include <cstdio>
 #include <ctime>
-#include <cmath>
-#include <sstream>
-#include <algorithm>
-
-// ============================================================================
-// Terminal UI
-// ============================================================================
-namespace term {
-inline void clear(){ std::cout << "\x1b[2J\x1b[H"; }
-inline std::string bold(const std::string& s){ return "\x1b[1m"+s+"\x1b[0m"; }
-inline std::string dim (const std::string& s){ return "\x1b[2m"+s+"\x1b[0m"; }
-inline std::string inv (const std::string& s){ return "\x1b[7m"+s+"\x1b[0m"; }
-inline int width(){ winsize w{}; ioctl(STDOUT_FILENO,TIOCGWINSZ,&w); return (w.ws_col>0)? w.ws_col : 80; }
-inline void println_center(const std::string& s){ int W=width(); int pad=(W-(int)s.size())/2; if(pad<0) pad=0; std::cout<<std::string(pad,' ')<<s<<"\n"; }
-}
-
-// ============================================================================
-// Teclado (raw no bloqueante)
-// ============================================================================
-namespace keys {
-enum Key { NONE=0, ENTER, UP, DOWN, LEFT, RIGHT, QUIT, W, A, S, D, NUM1, NUM2, NUM3, NUM4 };
-
-struct RawGuard {
-    termios old{}; bool active=false;
-    RawGuard(){
-        if(!isatty(STDIN_FILENO)) return;
-        tcgetattr(STDIN_FILENO,&old);
-        termios raw=old;
-        raw.c_lflag &= ~(ICANON|ECHO);
-        raw.c_cc[VMIN]=0; raw.c_cc[VTIME]=1;
-        tcsetattr(STDIN_FILENO,TCSAFLUSH,&raw);
-        active=true;
-    }
-    ~RawGuard(){ if(active) tcsetattr(STDIN_FILENO,TCSAFLUSH,&old); }
-};
-
-inline Key read(){
-    unsigned char buf[3]; ssize_t n=::read(STDIN_FILENO,buf,sizeof(buf));
-    if(n<=0) return NONE;
-    if(n==1){
-        unsigned char c=buf[0];
-        if(c=='\n'||c=='\r') return ENTER;
-        if(c=='q'||c=='Q')   return QUIT;
-        if(c=='w'||c=='W')   return W;
-        if(c=='a'||c=='A')   return A;
-        if(c=='s'||c=='S')   return S;
-        if(c=='d'||c=='D')   return D;
-        if(c=='1') return NUM1;
-        if(c=='2') return NUM2;
-        if(c=='3') return NUM3;
-        if(c=='4') return NUM4;
-        return NONE;
-    }
-    if(n==3 && buf[0]==0x1b && buf[1]=='['){
-        if(buf[2]=='A') return UP;
-        if(buf[2]=='B') return DOWN;
-        if(buf[2]=='C') return RIGHT;
-        if(buf[2]=='D') return LEFT;
-    }
-    return NONE;
-}
-}
-
-// Helpers para alternar modo raw/cooked cuando pedimos iniciales
-namespace tty_mode {
-static bool saved=false;
-static termios saved_t{};
-inline void init(){
-    if(!isatty(STDIN_FILENO)) return;
-    if(!saved){ tcgetattr(STDIN_FILENO,&saved_t); saved=true; }
-}
-inline void to_cooked(){
-    if(!saved) init();
-    if(!isatty(STDIN_FILENO)) return;
-    tcsetattr(STDIN_FILENO,TCSAFLUSH,&saved_t);
-}
-inline void to_raw(){
-    if(!saved) init();
-    if(!isatty(STDIN_FILENO)) return;
-    termios raw=saved_t;
-    raw.c_lflag &= ~(ICANON|ECHO);
-    raw.c_cc[VMIN]=0; raw.c_cc[VTIME]=1;
-    tcsetattr(STDIN_FILENO,TCSAFLUSH,&raw);
-}
-}
+#include <sys/stat.h>
+#include "term.hpp"
+#include "game.hpp"
+#include "render.hpp"
+#include "scores.hpp"
+#include "replay.hpp"
+#include "level.hpp"
+#include "engine.hpp"
+#include "batch.hpp"
+#include "prof.hpp"
+#include "agent.hpp"
+#include "net.hpp"
+#include "cast.hpp"
+#include "server.hpp"
+#include <csignal>
 
 // ============================================================================
 // Pantallas simples (Instrucciones / Puntajes / mensajes)
@@ -115,30 +44,63 @@ void screen_instrucciones(){
         "Power-up (P): Pac-Man puede comer fantasmas (huyen).",
         "Durante la partida presiona 'q' para volver al menú.",
         "",
-        "Se usan hilos con sincronizacion (mutex + condition variables)."
+        "Se usan hilos sincronizados con una barrera de fases (futex)."
     });
 }
 
-// Lee y muestra el archivo de puntajes con MAX/MIN resultantes
+// Fila de la tabla de estadísticas: partidas, media, desvío y percentiles
+static void stats_row(const char* name,const scores::Stats& st){
+    char buf[96];
+    snprintf(buf,sizeof(buf),"%-8s %8llu %8.0f %7.0f %7d %7d %7d",name,(unsigned long long)st.n,
+             st.mean,st.stddev(),st.quantile(0.5),st.quantile(0.9),st.quantile(0.99));
+    term::println_center(buf);
+}
+
+// Muestra estadísticas, top y últimas partidas desde los archivos laterales
+// (tamaño fijo: no se recorre el historial)
 void screen_puntajes_show(){
     term::clear();
     term::println_center(term::bold("PUNTAJES"));
     std::cout << "\n";
-    std::ifstream in("scores.txt");
-    if(!in){
-        term::println_center("No existe scores.txt aún. Juega una partida primero.");
+    scores::Index ix=scores::snapshot();
+    if(ix.count==0){
+        term::println_center("No hay puntajes aún. Juega una partida primero.");
     } else {
-        std::vector<std::string> lines;
-        std::string line;
-        while(std::getline(in,line)) lines.push_back(line);
-        if(lines.empty()){
-            term::println_center("scores.txt está vacío.");
-        } else {
-            // Mostrar las últimas 15 líneas para no saturar
-            int start = (int)std::max(0, (int)lines.size()-15);
-            for(int i=start;i<(int)lines.size();++i){
-                term::println_center(lines[i]);
-            }
+        scores::Summary ss=scores::stats();
+        char buf[96];
+        snprintf(buf,sizeof(buf),"Partidas: %llu | MAX: %s,%d | MIN: %s,%d",(unsigned long long)ss.all.n,
+                 scores::ini_str(ix.max.ini).c_str(),ix.max.score,scores::ini_str(ix.min.ini).c_str(),ix.min.score);
+        term::println_center(buf);
+        if(ss.merged){
+            snprintf(buf,sizeof(buf),"(%llu de %u otras máquinas; MAX/MIN, mejores y últimas son locales)",(unsigned long long)ss.merged,ss.sources);
+            term::println_center(term::dim(buf));
+        }
+        std::cout << "\n";
+        snprintf(buf,sizeof(buf),"%-8s %8s %8s %7s %7s %7s %7s","","Partidas","Media","Desv.","p50","p90","p99");
+        term::println_center(buf);         // sin negrita: los escapes correrían las columnas
+        stats_row("Total",ss.all);
+        for(int m=1;m<4;m++) if(ss.mode[m].n){ char name[16]; snprintf(name,sizeof name,"Modo %d",m); stats_row(name,ss.mode[m]); }
+        if(ss.mode[0].n) stats_row("Sin modo",ss.mode[0]);
+        // Las iniciales más jugadas
+        std::vector<const scores::IniStats*> ini;
+        for(const scores::IniStats& e: ss.ini) if(e.ini[0]) ini.push_back(&e);
+        size_t k=std::min<size_t>(ini.size(),5);
+        std::partial_sort(ini.begin(),ini.begin()+(long)k,ini.end(),[](auto* a,auto* b){ return a->st.n>b->st.n; });
+        for(size_t i=0;i<k;i++) stats_row(scores::ini_str(ini[i]->ini).c_str(),ini[i]->st);
+        if(ss.other.n) stats_row("Otros",ss.other);
+
+        // Mejores y últimas, lado a lado
+        std::cout << "\n";
+        term::println_center("Mejores              Últimas   ");
+        std::vector<scores::Record> last=scores::last(5);
+        for(int i=0;i<5;i++){
+            char a[32]="", b[32]="";
+            if(i<(int)ix.ntop) snprintf(a,sizeof a,"%2d. %-3s %7d",i+1,scores::ini_str(ix.top[i].ini).c_str(),ix.top[i].score);
+            int j=(int)last.size()-1-i;
+            if(j>=0) snprintf(b,sizeof b,"%-3s %7d",scores::ini_str(last[(size_t)j].ini).c_str(),last[(size_t)j].score);
+            if(!a[0] && !b[0]) break;
+            snprintf(buf,sizeof(buf),"%-16s     %-11s",a,b);
+            term::println_center(buf);
         }
     }
     std::cout << "\n";
@@ -147,446 +109,84 @@ void screen_puntajes_show(){
 }
 
 // ============================================================================
-// Estado del juego
+// Partida (montaje de hilos y join)
 // ============================================================================
-static const char WALL='#', TOKEN='.', POWER='P', EMPTY=' ', DOOR='-';
-static const int DIRS[4][2]={{0,-1},{-1,0},{0,1},{1,0}};
-
-struct GameState {
-    std::vector<std::string> maze_base;
-    std::vector<std::string> maze_live;
-    int H=0, W=0;
-
-    // Pac-Man
-    int px=1, py=1, pdx=1, pdy=0;
-    int lives=3;
-    int score=0;
-
-    // Comestibles
-    int tokens=0;
-    bool power=false;
-    int powerTimer=0;
-
-    // Control
-    bool stop=false;
-    std::string initials="";
-
-    // Fantasmas
-    struct Ghost{
-        std::string name;
-        int x=1,y=1,dx=0,dy=0;
-        int color=31;       // 31 rojo, 35 rosa, 36 cian, 33 naranja
-        bool inHouse=true;
-        int release=0;      // ticks para salir
-        int last_tick=0;    // última marca de tick procesada
-    };
-    Ghost blinky, pinky, inky, clyde;
-
-    // Casa
-    int houseX=0, houseY=0, doorY=0, doorX1=0, doorX2=0;
-
-    // ---------- 🔒 SINCRONIZACIÓN ----------
-    pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;        // Mutex
-    pthread_cond_t  cond_tick   = PTHREAD_COND_INITIALIZER; // New tick
-    pthread_cond_t  cond_render = PTHREAD_COND_INITIALIZER; // Ghosts ready
-    int tick_id=0;
-    int ghosts_done=0;
-    static constexpr int NUM_GHOSTS = 4;
-
-    // Modo 3 (Blinky humano)
-    bool blinky_human=false;
-    int blinky_cmd_dx=0, blinky_cmd_dy=0;
-
-    GameState(){
-        // ==== Mapa estilo clásico (simétrico) ====
-        maze_base = {
-"############################",
-"#............##............#",
-"#.####.#####.##.#####.####.#",
-"#P####.#####.##.#####.####P#",
-"#.####.#####.##.#####.####.#",
-"#..........................#",
-"#.####.##.########.##.####.#",
-"#......##....##....##......#",
-"######.##### ## #####.######",
-"     #.##### ## #####.#     ",
-"     #.##          ##.#     ",
-"     #.## ###--### ##.#     ",
-"######.## #      # ##.######",
-"      .   #      #   .      ",
-"######.## #      # ##.######",
-"     #.## ######## ##.#     ",
-"     #.##          ##.#     ",
-"     #.## ######## ##.#     ",
-"######.## ######## ##.######",
-"#............##............#",
-"#.####.#####.##.#####.####.#",
-"#P...#................#...P#",
-"####.#.##.########.##.#.####",
-"#......##....##....##......#",
-"#.##########.##.##########.#",
-"#..........................#",
-"############################"
-        };
-        maze_live = maze_base;
-        H=(int)maze_base.size(); W=(int)maze_base[0].size();
-
-        // Rellenar espacios con puntos
-        for(int y=0;y<H;y++) for(int x=0;x<W;x++) if(maze_live[y][x]==' ') maze_live[y][x]='.';
-
-        // Contar comestibles
-        tokens=0;
-        for(auto &row: maze_live) for(char c: row) if(c=='.'||c=='P') tokens++;
-
-        // Pac-Man
-        px=1; py=1; pdx=1; pdy=0;
-
-        // Detectar puerta/casa
-        for(int y=0;y<H;y++){
-            for(int x=0;x<W;x++){
-                if(maze_base[y][x]==DOOR){
-                    doorY=y;
-                    int a=x,b=x;
-                    while(a>0 && maze_base[y][a-1]==DOOR) a--;
-                    while(b+1<W && maze_base[y][b+1]==DOOR) b++;
-                    doorX1=a; doorX2=b; houseX=(a+b)/2; houseY=y+1;
-                }
-            }
-        }
-
-        // Quitar puntos dentro y alrededor de la casa
-        auto clear_dot=[&](int X,int Y){
-            if(Y>=0&&Y<H&&X>=0&&X<W){
-                if(maze_live[Y][X]=='.' || maze_live[Y][X]=='P'){
-                    maze_live[Y][X]=' ';
-                    --tokens;
-                }
-            }
-        };
-        for(int y=houseY-2; y<=houseY+2; ++y)
-            for(int x=doorX1-2; x<=doorX2+2; ++x)
-                clear_dot(x,y);
-        for(int x=doorX1-3; x<=doorX2+3; ++x) clear_dot(x,doorY);
-
-        // Fantasmas con salida escalonada (respawn rápido)
-        blinky={"Blinky",houseX,houseY,0,0,31,true,5,0};
-        pinky ={"Pinky", houseX,houseY,0,0,35,true,25,0};
-        inky  ={"Inky",  houseX,houseY,0,0,36,true,45,0};
-        clyde ={"Clyde", houseX,houseY,0,0,33,true,65,0};
-
-        power=false; powerTimer=0; stop=false;
+// Perfil por fase (--prof / --prof-out)
+static bool PROF_HUD=false;
+static std::string PROF_OUT;
+
+// Piloto automático (--autoplay): busca dentro del 60% de cada tick
+static bool AUTOPLAY=false;
+static agent::Options AGENT_OPT=[]{ agent::Options o; o.iters=4096; return o; }();
+
+// Grabación asciicast de los frames (--record / --record-diff)
+static cast::Recorder CAST;
+struct CastGuard {
+    ~CastGuard(){
+        if(!CAST.active()) return;
+        CAST.close();
+        fprintf(stderr,"Grabación: %llu frames, %llu descartados | %.1f MB escritos (%.0f MB/s)\n",
+                (unsigned long long)CAST.frames.load(),(unsigned long long)CAST.dropped.load(),
+                CAST.bytes_written.load()/1e6,CAST.mb_per_s());
     }
-
-    inline void wrap(int &x,int &y) const { if(x<0)x=W-1; if(x>=W)x=0; if(y<0)y=H-1; if(y>=H)y=0; }
-    inline bool is_wall(int x,int y) const { return maze_base[y][x]==WALL; }
-    inline bool is_door(int x,int y) const { return maze_base[y][x]==DOOR; }
-    inline bool solid_for_pacman(int x,int y) const { return is_wall(x,y)||is_door(x,y); }
-    inline bool solid_for_ghost (int x,int y) const { return is_wall(x,y); } // cruzan puerta
 };
 
-// ============================================================================
-// Render
-// ============================================================================
-static inline std::string color_cell(char c){
-    switch(c){
-        case '#': return "\033[34m#\033[0m";     // azul pared
-        case '.': return "\033[37m.\033[0m";     // punto
-        case 'P': return "\033[32mP\033[0m";     // power
-        case '-': return "\033[36m-\033[0m";     // puerta
-        case ' ': return " ";                   // vacío (comido)
-        default:  return std::string(1,c);
-    }
-}
-static inline std::string ghost_symbol(int ansiColor, bool frightened){
-    if(frightened) return "\033[34mF\033[0m";   // azul cuando huyen
-    return "\033["+std::to_string(ansiColor)+"mF\033[0m";
-}
-static inline std::string ghost_at(const GameState& s,int x,int y){
-    auto gstr = [&](const GameState::Ghost& g)->std::string{
-        if(!g.inHouse && g.x==x && g.y==y) return ghost_symbol(g.color, s.power);
-        return {};
-    };
-    std::string r=gstr(s.blinky); if(!r.empty()) return r;
-    r=gstr(s.pinky);  if(!r.empty()) return r;
-    r=gstr(s.inky);   if(!r.empty()) return r;
-    r=gstr(s.clyde);  return r;
-}
-static void render_locked(const GameState& s){
-    term::clear();
-    term::println_center(term::bold("=== PAC-MAN ==="));
-    std::cout<<"\n";
-    int margin=(term::width()-s.W)/2; if(margin<0) margin=0;
-
-    for(int y=0;y<s.H;y++){
-        std::string line;
-        for(int x=0;x<s.W;x++){
-            if(x==s.px && y==s.py) line+="\033[93mC\033[0m"; // Pac-Man visible
-            else {
-                std::string gh=ghost_at(s,x,y);
-                if(!gh.empty()) line+=gh;
-                else {
-                    char live = s.maze_live[y][x];
-                    if(live=='.' || live=='P' || live==' ') line+=color_cell(live);
-                    else line+=color_cell(s.maze_base[y][x]);
-                }
-            }
-        }
-        if(margin) std::cout<<std::string(margin,' ');
-        std::cout<<line<<"\n";
-    }
-    std::cout<<"\n";
-    term::println_center("Puntos: "+std::to_string(s.score)+" | Vidas: "+std::to_string(s.lives)+(s.power?" | POWER!":""));
-    std::cout.flush();
-}
-
-// ============================================================================
-// Comer y mover
-// ============================================================================
-static inline void eat_cell(GameState& s,int x,int y){
-    char &c = s.maze_live[y][x];
-    if(c==TOKEN){ s.score+=10; s.tokens--; c=EMPTY; }
-    else if(c==POWER){ s.score+=50; s.tokens--; c=EMPTY; s.power=true; s.powerTimer=120; } // power corto
-}
-static inline void move_pacman(GameState& s,int dx,int dy){
-    int nx=s.px+dx, ny=s.py+dy; s.wrap(nx,ny);
-    if(!s.solid_for_pacman(nx,ny)){ s.px=nx; s.py=ny; s.pdx=dx; s.pdy=dy; eat_cell(s,nx,ny); }
-}
-
-// ============================================================================
-// IA fantasmas
-// ============================================================================
-static inline int dist2(int ax,int ay,int bx,int by){ int dx=ax-bx,dy=ay-by; return dx*dx+dy*dy; }
-static inline void compute_target(const GameState& s,const GameState::Ghost& bl,const GameState::Ghost& me,int &tx,int &ty){
-    if(s.power){
-        int cands[4][2]={{1,1},{s.W-2,1},{1,s.H-2},{s.W-2,s.H-2}};
-        int best=-1e9; tx=1; ty=1;
-        for(auto &c:cands){ int d=-dist2(c[0],c[1],s.px,s.py); if(d>best){best=d; tx=c[0]; ty=c[1];} }
-        return;
-    }
-    if(me.name=="Blinky"){ tx=s.px; ty=s.py; return; }
-    if(me.name=="Pinky"){  tx=s.px+s.pdx*4; ty=s.py+s.pdy*4; tx=std::max(0,std::min(s.W-1,tx)); ty=std::max(0,std::min(s.H-1,ty)); return; }
-    if(me.name=="Inky"){   int ix=s.px+2*s.pdx,iy=s.py+2*s.pdy; tx=2*ix-bl.x; ty=2*iy-bl.y; tx=std::max(0,std::min(s.W-1,tx)); ty=std::max(0,std::min(s.H-1,ty)); return; }
-    if(me.name=="Clyde"){  int d=dist2(me.x,me.y,s.px,s.py); if(d>64){ tx=s.px; ty=s.py; } else { tx=1; ty=s.H-2; } return; }
-    tx=s.px; ty=s.py;
-}
-static inline bool can_move_ghost(const GameState& s,const GameState::Ghost& g,int ndx,int ndy){
-    int nx=g.x+ndx,ny=g.y+ndy;
-    if(ny<0||ny>=s.H||nx<0||nx>=s.W) return false;
-    if(s.solid_for_ghost(nx,ny)) return false;
-    return true;
-}
-static inline void step_towards(GameState& s,GameState::Ghost& g,int tx,int ty){
-    int best=1e9,bdx=0,bdy=0;
-    for(auto &d:DIRS){
-        int ndx=d[0],ndy=d[1];
-        if(ndx==-g.dx && ndy==-g.dy) continue; // evita reversa inmediata
-        if(!can_move_ghost(s,g,ndx,ndy)) continue;
-        int nx=g.x+ndx,ny=g.y+ndy; s.wrap(nx,ny);
-        int dd=dist2(nx,ny,tx,ty);
-        if(dd<best){ best=dd; bdx=ndx; bdy=ndy; }
-    }
-    if(best==1e9){
-        if(can_move_ghost(s,g,-g.dx,-g.dy)){ g.x-=g.dx; g.y-=g.dy; g.dx=-g.dx; g.dy=-g.dy; return; }
-        for(auto &d:DIRS){ if(can_move_ghost(s,g,d[0],d[1])){ g.x+=d[0]; g.y+=d[1]; g.dx=d[0]; g.dy=d[1]; return; } }
-        return;
-    }
-    g.x+=bdx; g.y+=bdy; g.dx=bdx; g.dy=bdy;
-}
-static inline void ghost_tick_ai(GameState& s,GameState::Ghost& g){
-    if(g.inHouse){
-        if(g.release>0){ g.release--; return; }
-        if(g.y>s.doorY){
-            int ny=g.y-1; if(!s.solid_for_ghost(g.x,ny)){ g.y--; return; }
-        }
-        g.inHouse=false; g.dx=1; g.dy=0;
-    }
-    int tx=0,ty=0; compute_target(s,s.blinky,g,tx,ty); step_towards(s,g,tx,ty);
-}
-
-// ============================================================================
-// Colisiones
-// ============================================================================
-static inline void handle_collisions(GameState& s){
-    auto touch=[&](GameState::Ghost& g){
-        if(g.inHouse) return;
-        if(s.px==g.x && s.py==g.y){
-            if(s.power){
-                s.score+=200;
-                g.inHouse=true; g.x=s.houseX; g.y=s.houseY; g.dx=g.dy=0; g.release=5; // revive rápido
-            }else{
-                s.lives--;
-                s.px=1; s.py=1; s.pdx=1; s.pdy=0;
-            }
-        }
-    };
-    touch(s.blinky); touch(s.pinky); touch(s.inky); touch(s.clyde);
-    if(s.power){ s.powerTimer--; if(s.powerTimer<=0) s.power=false; }
-}
-
-// ============================================================================
-// Hilos y sincronización
-// ============================================================================
-enum GameMode { MODE_1=0, MODE_2=1, MODE_3=2 };
-static int TICK_US=90000;
-
-struct GhostArgs { GameState* st; GameState::Ghost* g; GameMode mode; };
-
-void* pacman_thread(void* arg){
-    GameState* s=(GameState*)arg;
-    keys::RawGuard rg;
-    while(true){
-        keys::Key k=keys::read();
-
-        pthread_mutex_lock(&s->mtx);
-        if(s->stop||s->lives<=0||s->tokens<=0){ pthread_mutex_unlock(&s->mtx); break; }
-
-        if(k==keys::QUIT){ s->stop=true; pthread_mutex_unlock(&s->mtx); break; }
-
-        int dx=0,dy=0;
-        if(k==keys::LEFT) dx=-1;
-        if(k==keys::RIGHT) dx=+1;
-        if(k==keys::UP) dy=-1;
-        if(k==keys::DOWN) dy=+1;
-        if(dx||dy) move_pacman(*s,dx,dy);
-
-        // Modo 3: comando humano para Blinky
-        s->blinky_cmd_dx=0; s->blinky_cmd_dy=0;
-        if(s->blinky_human){
-            if(k==keys::A) s->blinky_cmd_dx=-1;
-            else if(k==keys::D) s->blinky_cmd_dx=+1;
-            else if(k==keys::W) s->blinky_cmd_dy=-1;
-            else if(k==keys::S) s->blinky_cmd_dy=+1;
-        }
-
-        // Lanzar tick
-        s->ghosts_done=0;
-        s->tick_id++;
-        pthread_cond_broadcast(&s->cond_tick);
-
-        // Esperar a TODOS los fantasmas
-        while(!s->stop && s->ghosts_done < GameState::NUM_GHOSTS)
-            pthread_cond_wait(&s->cond_render,&s->mtx);
-
-        // Colisiones + render
-        if(!s->stop){ handle_collisions(*s); render_locked(*s); }
-
-        bool finished=(s->stop||s->lives<=0||s->tokens<=0);
-        pthread_mutex_unlock(&s->mtx);
-
-        if(finished) break;
-        usleep(TICK_US);
-    }
-    return nullptr;
+// Servidor de partidas (--serve): corre hasta Ctrl-C, estadísticas cada 5 s
+static volatile sig_atomic_t SERVE_STOP=0;
+static int serve(const std::string& path,GameMode mode,int workers){
+    server::Options o; o.mode=mode; o.workers=workers; o.ghosts=GHOST_COUNT;
+    server::Server srv(o);
+    std::string err;
+    if(!srv.listen(path,&err)){ fprintf(stderr,"socket %s: %s\n",path.c_str(),err.c_str()); return 1; }
+    signal(SIGINT,[](int){ SERVE_STOP=1; });
+    signal(SIGTERM,[](int){ SERVE_STOP=1; });
+    fprintf(stderr,"Sirviendo partidas en %s (modo %d, tick %d us, %d workers); entrar con --attach %s\n",
+            path.c_str(),(int)mode+1,TICK_US,srv.workers(),path.c_str());
+    srv.run(&SERVE_STOP,5);
+    fprintf(stderr,"%llu sesiones atendidas, %llu ticks de sesión\n",
+            (unsigned long long)srv.accepted,(unsigned long long)srv.session_ticks);
+    return 0;
 }
 
-void* ghost_thread(void* arg){
-    GhostArgs* a=(GhostArgs*)arg;
-    GameState* s=a->st;
-    GameState::Ghost* g=a->g;
-    GameMode mode=a->mode;
-
-    while(true){
-        pthread_mutex_lock(&s->mtx);
-        if(s->stop||s->lives<=0||s->tokens<=0){ pthread_mutex_unlock(&s->mtx); break; }
-
-        // Esperar nuevo tick
-        while(!s->stop && g->last_tick >= s->tick_id)
-            pthread_cond_wait(&s->cond_tick,&s->mtx);
-        if(s->stop||s->lives<=0||s->tokens<=0){ pthread_mutex_unlock(&s->mtx); break; }
-
-        // Ejecutar un paso
-        if(mode==MODE_3 && g->name=="Blinky" && !g->inHouse){
-            int ddx=s->blinky_cmd_dx, ddy=s->blinky_cmd_dy;
-            if(ddx||ddy){
-                int nx=g->x+ddx, ny=g->y+ddy; s->wrap(nx,ny);
-                if(!s->solid_for_ghost(nx,ny)){ g->x=nx; g->y=ny; g->dx=ddx; g->dy=ddy; }
-            }else{
-                ghost_tick_ai(*s,*g);
-            }
-        }else{
-            ghost_tick_ai(*s,*g);
-        }
-
-        // Marcar tick consumido
-        g->last_tick = s->tick_id;
-
-        // Contabilizar fantasma listo
-        s->ghosts_done++;
-        if(s->ghosts_done >= GameState::NUM_GHOSTS)
-            pthread_cond_signal(&s->cond_render);
-
-        pthread_mutex_unlock(&s->mtx);
-        usleep(TICK_US/2);
-    }
-
-    return nullptr;
-}
+// Blinky por la red (--host): el cliente conectado manda sus comandos
+static net::Host* NET_HOST=nullptr;
 
-// ============================================================================
-// Puntajes: Guardar + anexar MAX/MIN en el mismo archivo
-// ============================================================================
-static void save_score_and_update_summary(const std::string& initials,int score){
-    // Guarda puntaje de la partida
-    {
-        std::ofstream out("scores.txt",std::ios::app);
-        out<<initials<<","<<score<<"\n";
+static void start_game(GameState& state, GameMode mode){
+    g_renderer.invalidate(); g_renderer.reset_stats();
+
+    // Hilos (Pac-Man + 4 fantasmas) hasta fin de partida
+    replay::Recorder rec;
+    Session ss; ss.st=&state; ss.mode=mode; ss.sync=TICK_SYNC; ss.pin=PIN_THREADS; ss.rec=&rec;
+    ss.prof_hud=PROF_HUD;
+    std::unique_ptr<agent::Pilot> pilot;
+    if(AUTOPLAY){
+        agent::Options o=AGENT_OPT; o.mode=mode; o.seed=RNG_SEED;
+        o.budget_us=(uint64_t)std::max(TICK_US,1000)*6/10;
+        pilot=std::make_unique<agent::Pilot>(o);
+        ss.pilot=[&](const SimState& s){ return pilot->decide(s); };
     }
-
-    // Recalcula MAX/MIN leyendo todo el archivo
-    std::ifstream in("scores.txt");
-    std::string line;
-    int maxS=-1000000000, minS=1000000000;
-    std::string maxI="N/A", minI="N/A";
-    while(std::getline(in,line)){
-        // Saltar líneas de resumen previas (MAX:/MIN:)
-        if(line.rfind("MAX:",0)==0 || line.rfind("MIN:",0)==0 || line.rfind("---",0)==0) continue;
-        std::stringstream ss(line);
-        std::string ini; int sc;
-        if(std::getline(ss,ini,',') && (ss>>sc)){
-            if(sc>maxS){maxS=sc; maxI=ini;}
-            if(sc<minS){minS=sc; minI=ini;}
-        }
+    if(NET_HOST){
+        ss.remote=[](TickInput& in){ NET_HOST->poll_input(in); };
+        ss.on_tick=[](const SimState& s){ NET_HOST->send_tick(s); };
     }
-    in.close();
-
-    // Anexa resumen actual al final del archivo
-    {
-        std::ofstream out("scores.txt",std::ios::app);
-        out<<"--- RESUMEN ---\n";
-        out<<"MAX: "<<maxI<<","<<maxS<<"\n";
-        out<<"MIN: "<<minI<<","<<minS<<"\n";
+    run_session(ss);
+    if(NET_HOST) NET_HOST->bye();
+    g_renderer.hud.clear();
+
+    // Replay de la sesión
+    std::string replay_path;
+    if(rec.ticks>0){
+        mkdir(replay::DIR_PATH,0755);
+        char name[64]; time_t now=time(nullptr); tm lt{}; localtime_r(&now,&lt);
+        strftime(name,sizeof(name),"%Y%m%d-%H%M%S",&lt);
+        replay_path=std::string(replay::DIR_PATH)+"/"+name+"-"+(state.initials.empty()?"___":state.initials)+".pmr";
+        replay::Header h;
+        h.seed=RNG_SEED; h.tick_us=(uint32_t)TICK_US; h.mode=(uint8_t)mode; h.nav=(uint8_t)GHOST_NAV;
+        h.ghosts=(uint32_t)state.gh.n;
+        h.level=state.maze->source; h.level_hash=state.maze->hash;
+        h.initials=state.initials; h.score=state.score; h.lives=state.lives;
+        if(!replay::save(replay_path,h,rec)) replay_path.clear();
     }
-}
-
-// ============================================================================
-// Partida (montaje de hilos y join)
-// ============================================================================
-static void start_game(GameState& state, GameMode mode){
-    // Reset básico
-    pthread_mutex_lock(&state.mtx);
-    state.stop=false; state.tick_id=0; state.ghosts_done=0;
-    state.blinky_cmd_dx=state.blinky_cmd_dy=0;
-    pthread_mutex_unlock(&state.mtx);
-
-    // Hilos
-    pthread_t tpac, tg1, tg2, tg3, tg4;
-    GhostArgs a1{&state, &state.blinky, mode};
-    GhostArgs a2{&state, &state.pinky , mode};
-    GhostArgs a3{&state, &state.inky  , mode};
-    GhostArgs a4{&state, &state.clyde , mode};
-
-    pthread_create(&tpac, nullptr, pacman_thread, &state);
-    pthread_create(&tg1,  nullptr, ghost_thread,  &a1);
-    pthread_create(&tg2,  nullptr, ghost_thread,  &a2);
-    pthread_create(&tg3,  nullptr, ghost_thread,  &a3);
-    pthread_create(&tg4,  nullptr, ghost_thread,  &a4);
-
-    // Esperar fin de partida
-    pthread_join(tpac,nullptr);
-    pthread_join(tg1,nullptr);
-    pthread_join(tg2,nullptr);
-    pthread_join(tg3,nullptr);
-    pthread_join(tg4,nullptr);
 
     // Resultado final + guardado de puntaje
     pthread_mutex_lock(&state.mtx);
@@ -595,9 +195,44 @@ static void start_game(GameState& state, GameMode mode){
     else if(state.lives<=0)  term::println_center(term::bold("Game Over"));
     else if(state.stop)      term::println_center(term::bold("Has regresado al menú"));
     term::println_center("Puntaje final: "+std::to_string(state.score));
+    if(g_renderer.frames>0){
+        char st[128];
+        snprintf(st,sizeof(st),"Render: %llu frames | %.0f bytes/frame | %.1f us/frame | %llu saltados",
+                 (unsigned long long)g_renderer.frames,
+                 (double)g_renderer.bytes_total/g_renderer.frames,
+                 g_renderer.ns_total/1000.0/g_renderer.frames,
+                 (unsigned long long)(ss.frames_published-ss.frames_drawn));
+        term::println_center(term::dim(st));
+    }
+    if(pilot && pilot->stats.decisions>0){
+        char st[128];
+        snprintf(st,sizeof(st),"Piloto: %llu jugadas | %.0f nodos/s | %.0f us/jugada | %d hilos",
+                 (unsigned long long)pilot->stats.decisions,pilot->stats.nodes_per_s(),
+                 pilot->stats.us_per_decision(),pilot->opt.threads);
+        term::println_center(term::dim(st));
+    }
+    if(NET_HOST && NET_HOST->snapshots>0){
+        char st[128];
+        snprintf(st,sizeof(st),"Red: %llu fotos (%llu completas) | %.0f bytes/tick",
+                 (unsigned long long)NET_HOST->snapshots,(unsigned long long)NET_HOST->full_snapshots,
+                 (double)NET_HOST->bytes_sent/NET_HOST->snapshots);
+        term::println_center(term::dim(st));
+    }
+    TickLatency::Summary lat=ss.latency.summary();
+    if(lat.n>0){
+        char st[128];
+        snprintf(st,sizeof(st),"Tick (%s): media %.1f us | p99 %.1f us | max %.1f us",
+                 sync_name(ss.sync),lat.mean_us,lat.p99_us,lat.max_us);
+        term::println_center(term::dim(st));
+    }
+    if(!replay_path.empty()) term::println_center(term::dim("Replay: "+replay_path));
+    if(prof::enabled){
+        term::println_center(term::dim(prof::hud_line()));
+        if(!PROF_OUT.empty() && prof::dump_file(PROF_OUT,TICK_US)) term::println_center(term::dim("Perfil: "+PROF_OUT));
+    }
     pthread_mutex_unlock(&state.mtx);
 
-    save_score_and_update_summary(state.initials,state.score);
+    save_score_and_update_summary(state.initials,state.score,(int)mode+1);
 }
 
 // ============================================================================
@@ -641,9 +276,136 @@ static void select_mode(GameMode& mode, GameState& state){
 // ============================================================================
 // MAIN
 // ============================================================================
-int main(){
-    srand((unsigned)time(nullptr));
+int main(int argc,char** argv){
+    bool run_batch=false; batch::Options bopt;
+    std::string replay_file; long replay_seek=0; bool replay_verify=false;
+    int host_port=-1; std::string connect_addr;
+    std::string record_file; bool record_diff=false;
+    std::string serve_path, attach_path; int server_workers=0;
+    for(int i=1;i<argc;i++){
+        std::string a=argv[i];
+        auto val=[&](){ return (i+1<argc)? std::string(argv[++i]) : std::string(); };
+        if(a=="--render-stats") g_renderer.show_stats=true;
+        else if(a=="--minimap") g_renderer.minimap=true;
+        else if(a=="--sync-render") RENDER_THREAD=false;
+        else if(a=="--fps") RENDER_FPS=std::max(0,atoi(val().c_str()));
+        else if(a=="--autoplay") AUTOPLAY=true;
+        else if(a=="--agent") bopt.agent=true;
+        else if(a=="--agent-iters"){ AGENT_OPT.iters=bopt.agent_iters=std::max(1,atoi(val().c_str())); }
+        else if(a=="--agent-threads"){ AGENT_OPT.threads=bopt.agent_threads=std::max(1,atoi(val().c_str())); }
+        else if(a=="--batch"){ run_batch=true; bopt.games=std::max(1,atoi(val().c_str())); }
+        else if(a=="--seed") bopt.seed=strtoull(val().c_str(),nullptr,10);
+        else if(a=="--threads") bopt.threads=atoi(val().c_str());
+        else if(a=="--max-ticks") bopt.max_ticks=std::max(1,atoi(val().c_str()));
+        else if(a=="--mode"){ int m=atoi(val().c_str()); bopt.mode = m==3? MODE_3 : (m==2? MODE_2 : MODE_1); }
+        else if(a=="--sync"){ std::string v=val(); TICK_SYNC = v=="condvar"? SYNC_CONDVAR : v=="coro"? SYNC_CORO : SYNC_BARRIER; }
+        else if(a=="--pin") PIN_THREADS=true;
+        else if(a=="--prof"){ prof::enabled=true; PROF_HUD=true; }
+        else if(a=="--prof-out"){ prof::enabled=true; PROF_OUT=val(); }
+        else if(a=="--ghosts") GHOST_COUNT=std::max(0,std::min(MAX_GHOSTS,atoi(val().c_str())));
+        else if(a=="--workers") GHOST_WORKERS=std::max(1,atoi(val().c_str()));
+        else if(a=="--nav") GHOST_NAV = val()=="euclid"? NAV_EUCLID : NAV_PATH;
+        else if(a=="--no-corridors") GHOST_CORRIDORS=false;
+        else if(a=="--import-scores"){
+            std::string p=val(); if(p.empty()) p=scores::LEGACY_PATH;
+            long n=scores::import_legacy(p.c_str());
+            scores::shutdown();
+            if(n<0){ fprintf(stderr,"no se pudo leer %s\n",p.c_str()); return 1; }
+            printf("importados %ld puntajes de %s\n",n,p.c_str());
+            return 0;
+        }
+        else if(a=="--merge-stats"){
+            // Suma el scores.stats de otra máquina (reemplaza lo sumado antes de ella)
+            std::string p=val();
+            long n=scores::merge_stats(p.c_str());
+            scores::shutdown();
+            if(n<0){ fprintf(stderr,"no se pudo leer %s (¿es un %s?)\n",p.c_str(),scores::STATS_PATH); return 1; }
+            printf("sumadas %ld partidas nuevas de %s\n",n,p.c_str());
+            return 0;
+        }
+        else if(a=="--level"){
+            // Ruta absoluta: los replays la guardan para volver a cargar el nivel
+            std::string p=val(), err;
+            char* abs=realpath(p.c_str(),nullptr);
+            if(abs){ p=abs; free(abs); }
+            auto m=level::load(p,&err);
+            if(!m){ fprintf(stderr,"nivel %s: %s\n",p.c_str(),err.c_str()); return 1; }
+            Maze::set_current(m);
+        }
+        else if(a=="--gen"){
+            // Un laberinto nuevo por partida del batch (semilla de cada partida)
+            std::string err; level::GenOptions go;
+            bopt.gen=val();
+            if(bopt.gen.compare(0,4,"gen:")==0) bopt.gen.erase(0,4);
+            if(!level::parse_gen(bopt.gen,go,&err)){ fprintf(stderr,"%s\n",err.c_str()); return 1; }
+        }
+        else if(a=="--level-compile"){
+            std::string in=val(), out=val(), err;
+            uint64_t t0=now_ns();
+            auto m=level::load(in,&err);
+            if(!m){ fprintf(stderr,"nivel %s: %s\n",in.c_str(),err.c_str()); return 1; }
+            bool text= out.size()>4 && out.compare(out.size()-4,4,".txt")==0;    // .txt: para editar
+            if(!(text? level::save_text(*m,out) : level::save_binary(*m,out))){ fprintf(stderr,"no se pudo escribir %s\n",out.c_str()); return 1; }
+            printf("%s -> %s: %dx%d, %d fichas, hash %016llx (%.1f ms)\n",in.c_str(),out.c_str(),m->W,m->H,
+                   m->tokens0_count,(unsigned long long)m->hash,(now_ns()-t0)/1e6);
+            return 0;
+        }
+        else if(a=="--host"){ std::string p=val(); host_port= p.empty()? net::DEFAULT_PORT : atoi(p.c_str()); }
+        else if(a=="--connect") connect_addr=val();
+        else if(a=="--serve") serve_path=val();
+        else if(a=="--server-workers") server_workers=std::max(1,atoi(val().c_str()));
+        else if(a=="--attach") attach_path=val();
+        else if(a=="--record") record_file=val();
+        else if(a=="--record-diff") record_diff=true;
+        else if(a=="--tick-us") TICK_US=std::max(0,atoi(val().c_str()));
+        else if(a=="--replay") replay_file=val();
+        else if(a=="--seek") replay_seek=atol(val().c_str());
+        else if(a=="--verify") replay_verify=true;
+        else if(a=="--checksums") bopt.checksums=true;
+        else if(a=="--zobrist-check") ZOBRIST_CHECK=true;
+        else if(a=="--script"){
+            std::ifstream f(val()); std::string line;
+            while(std::getline(f,line)) bopt.script+=line;
+        }
+    }
+    if(run_batch) return batch::run(bopt);
+    if(!serve_path.empty()) return serve(serve_path,bopt.mode,server_workers);
+    if(!attach_path.empty()) return server::attach(attach_path);
+    CastGuard cast_guard;
+    if(!record_file.empty()){
+        std::string err;
+        if(!CAST.open(record_file,term::width(),term::height(),record_diff,cast::DEFAULT_RING,&err)){
+            fprintf(stderr,"grabación: %s\n",err.c_str()); return 1;
+        }
+        g_renderer.rec=&CAST;
+    }
+    if(!replay_file.empty()){ term::install_winch(); return replay::play(replay_file,replay_seek,replay_verify,bopt.checksums); }
+    if(!connect_addr.empty()){ term::install_winch(); return net::client_game(connect_addr); }
+    if(host_port>=0){
+        // Modo 3 con Blinky remoto: Pac-Man juega acá con las flechas
+        net::Host host; std::string err;
+        if(!host.listen(host_port,&err)){ fprintf(stderr,"puerto %d: %s\n",host_port,err.c_str()); return 1; }
+        GameState state;
+        state.initials="NET"; state.blinky_human=true;
+        printf("Esperando a Blinky en el puerto %d...\n",host.port());
+        fflush(stdout);
+        if(!host.accept_client(*state.maze,MODE_3,state.gh.n,TICK_US,120000,&err)){
+            fprintf(stderr,"sin cliente: %s\n",err.c_str()); return 1;
+        }
+        RNG_SEED=(uint64_t)time(nullptr);
+        srand((unsigned)RNG_SEED);
+        term::install_winch();
+        NET_HOST=&host;
+        start_game(state,MODE_3);
+        NET_HOST=nullptr;
+        scores::shutdown();
+        return 0;
+    }
+
+    RNG_SEED=(uint64_t)time(nullptr);
+    srand((unsigned)RNG_SEED);
     tty_mode::init();
+    term::install_winch();
 
     GameState state;
     GameMode mode=MODE_1;
@@ -666,6 +428,7 @@ int main(){
             // Reset de estado (incluye limpieza en casa de fantasmas)
             state = GameState();
             state.initials = ini;
+            state.blinky_human = (mode==MODE_3);
 
             // Inicia partida
             start_game(state, mode);
@@ -691,5 +454,6 @@ int main(){
             items[sel].action();
         }
     }
+    scores::shutdown();
     return 0;
 }
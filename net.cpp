@@ -0,0 +1,568 @@
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "net.hpp"
+#include "level.hpp"
+#include "render.hpp"
+#include "replay.hpp"
+
+namespace net {
+
+using replay::put_varint;
+using replay::get_varint;
+using replay::zigzag;
+using replay::unzigzag;
+
+namespace {
+// Máscara de SNAPSHOT: qué campos vienen (en una completa, todos)
+constexpr uint8_t F_PAC=1, F_SCORE=2, F_LIVES=4, F_TOKENS=8, F_POWER=16, F_OVER=32;
+constexpr uint8_t F_GHOSTS_FULL=64;     // lista completa de fantasmas
+constexpr uint8_t F_PLANES_FULL=128;    // planos crudos (si no, bits que cambiaron)
+constexpr size_t MAX_FRAME=64u<<20;     // el nivel más grande entra holgado
+
+void put_frame(std::vector<uint8_t>& out,MsgType t,const std::vector<uint8_t>& body){
+    put_varint(out,body.size()+1);
+    out.push_back((uint8_t)t);
+    out.insert(out.end(),body.begin(),body.end());
+}
+
+// Llama a fn(tipo,cuerpo,fin) por cada mensaje completo de `in` y deja lo
+// incompleto al principio. false si el stream es inválido o fn lo rechaza.
+template<class F> bool drain_frames(std::vector<uint8_t>& in,F&& fn){
+    const uint8_t* p=in.data(); const uint8_t* end=p+in.size();
+    bool ok=true;
+    while(ok && p<end){
+        const uint8_t* q=p; uint64_t len;
+        if(!get_varint(q,end,len)){ if(end-p>10) ok=false; break; }
+        if(len==0 || len>MAX_FRAME){ ok=false; break; }
+        if((uint64_t)(end-q)<len) break;
+        ok=fn((MsgType)q[0],q+1,q+len);
+        p=q+len;
+    }
+    in.erase(in.begin(),in.begin()+(p-in.data()));
+    return ok;
+}
+
+// Todo lo que haya en el socket (no bloqueante); false si se cerró o falló
+bool read_some(int fd,std::vector<uint8_t>& in,uint64_t* counted=nullptr){
+    uint8_t buf[16384];
+    while(true){
+        ssize_t n=recv(fd,buf,sizeof buf,MSG_DONTWAIT);
+        if(n>0){ in.insert(in.end(),buf,buf+n); if(counted) *counted+=(uint64_t)n; continue; }
+        if(n<0 && errno==EINTR) continue;
+        if(n<0 && (errno==EAGAIN||errno==EWOULDBLOCK)) return true;
+        return false;
+    }
+}
+
+// Escribe lo que acepte el socket y deja el resto en out; false si falló
+bool write_some(int fd,std::vector<uint8_t>& out){
+    size_t off=0;
+    while(off<out.size()){
+        ssize_t n=send(fd,out.data()+off,out.size()-off,MSG_DONTWAIT|MSG_NOSIGNAL);
+        if(n>0){ off+=(size_t)n; continue; }
+        if(n<0 && errno==EINTR) continue;
+        if(n<0 && (errno==EAGAIN||errno==EWOULDBLOCK)) break;
+        out.clear(); return false;
+    }
+    out.erase(out.begin(),out.begin()+off);
+    return true;
+}
+
+// Espera un mensaje de tipo t (handshake); el cuerpo queda en body y lo que
+// haya llegado detrás sigue en `in`
+bool wait_frame(int fd,std::vector<uint8_t>& in,MsgType t,std::vector<uint8_t>& body,int timeout_ms){
+    uint64_t deadline=now_ns()+(uint64_t)std::max(timeout_ms,0)*1000000ull;
+    while(true){
+        const uint8_t* p=in.data(); const uint8_t* end=p+in.size(); uint64_t len;
+        if(get_varint(p,end,len)){
+            if(len==0 || len>MAX_FRAME) return false;
+            if((uint64_t)(end-p)>=len){
+                if(p[0]!=t) return false;
+                body.assign(p+1,p+len);
+                in.erase(in.begin(),in.begin()+((p+len)-in.data()));
+                return true;
+            }
+        }
+        uint64_t now=now_ns();
+        if(now>=deadline) return false;
+        pollfd pf{fd,POLLIN,0};
+        int r=poll(&pf,1,(int)((deadline-now)/1000000ull)+1);
+        if(r<0 && errno!=EINTR) return false;
+        if(r>0){
+            size_t before=in.size();
+            if(!read_some(fd,in) || in.size()==before) return false;
+        }
+    }
+}
+
+void set_nodelay(int fd){ int one=1; setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof one); }
+
+inline void put_u16(std::vector<uint8_t>& out,int v){ put_varint(out,(uint16_t)v); }
+inline uint8_t dir_code(int dx,int dy){ return (uint8_t)((dx+1)*3+(dy+1)); }
+}
+
+// ============================================================================
+// Fotos y deltas
+// ============================================================================
+void Snapshot::capture(const SimState& s){
+    tick=(uint32_t)s.tick_id;
+    px=s.px; py=s.py; pdx=s.pdx; pdy=s.pdy;
+    score=s.score; lives=s.lives; tokens=s.tokens;
+    power=s.power; over=game_finished(s);
+    gx.assign(s.gh.x.begin(),s.gh.x.end());
+    gy.assign(s.gh.y.begin(),s.gh.y.end());
+    gin.assign(s.gh.in_house.begin(),s.gh.in_house.end());
+    dots=s.dots; pellets=s.pellets;
+}
+
+void encode_snapshot(const Snapshot& cur,const Snapshot* base,uint32_t input_ack,std::vector<uint8_t>& out){
+    put_varint(out,cur.tick); put_varint(out,base? base->tick : 0); put_varint(out,input_ack);
+    size_t n=cur.gx.size();
+    bool planes_full = !base || base->dots.w.size()!=cur.dots.w.size() || base->pellets.w.size()!=cur.pellets.w.size();
+    uint8_t mask=0;
+    if(!base || cur.px!=base->px || cur.py!=base->py || cur.pdx!=base->pdx || cur.pdy!=base->pdy) mask|=F_PAC;
+    if(!base || cur.score!=base->score) mask|=F_SCORE;
+    if(!base || cur.lives!=base->lives) mask|=F_LIVES;
+    if(!base || cur.tokens!=base->tokens) mask|=F_TOKENS;
+    if(!base || cur.power!=base->power) mask|=F_POWER;
+    if(!base || cur.over!=base->over) mask|=F_OVER;
+    if(!base || base->gx.size()!=n) mask|=F_GHOSTS_FULL;
+    if(planes_full) mask|=F_PLANES_FULL;
+    out.push_back(mask);
+
+    if(mask&F_PAC){ put_varint(out,zigzag(cur.px)); put_varint(out,zigzag(cur.py)); out.push_back(dir_code(cur.pdx,cur.pdy)); }
+    if(mask&F_SCORE) put_varint(out,zigzag(cur.score));
+    if(mask&F_LIVES) put_varint(out,zigzag(cur.lives));
+    if(mask&F_TOKENS) put_varint(out,zigzag(cur.tokens));
+    if(mask&F_POWER) out.push_back(cur.power);
+    if(mask&F_OVER) out.push_back(cur.over);
+
+    // Fantasmas: completa = (x, y, casa) de todos; delta = los que cambiaron,
+    // con el salto de índice y un paso de una celda en un byte (0 = x, y, casa)
+    if(mask&F_GHOSTS_FULL){
+        put_varint(out,n);
+        for(size_t i=0;i<n;i++){ put_u16(out,cur.gx[i]); put_u16(out,cur.gy[i]); out.push_back(cur.gin[i]); }
+    }else{
+        size_t changed=0;
+        for(size_t i=0;i<n;i++) changed += cur.gx[i]!=base->gx[i] || cur.gy[i]!=base->gy[i] || cur.gin[i]!=base->gin[i];
+        put_varint(out,changed);
+        size_t prev=0;
+        for(size_t i=0;i<n;i++){
+            int dx=cur.gx[i]-base->gx[i], dy=cur.gy[i]-base->gy[i];
+            if(!dx && !dy && cur.gin[i]==base->gin[i]) continue;
+            put_varint(out,i-prev); prev=i;
+            if(cur.gin[i]==base->gin[i] && dx>=-1 && dx<=1 && dy>=-1 && dy<=1) out.push_back((uint8_t)(1+dir_code(dx,dy)));
+            else { out.push_back(0); put_u16(out,cur.gx[i]); put_u16(out,cur.gy[i]); out.push_back(cur.gin[i]); }
+        }
+    }
+
+    // Planos: completa = palabras crudas; delta = posiciones de los bits que
+    // cambiaron (fichas comidas), en orden y como saltos
+    for(int k=0;k<2;k++){
+        const BitPlane& c= k? cur.pellets : cur.dots;
+        if(planes_full){
+            put_varint(out,c.w.size());
+            const uint8_t* b=(const uint8_t*)c.w.data();
+            out.insert(out.end(),b,b+c.w.size()*8);
+            continue;
+        }
+        const BitPlane& b= k? base->pellets : base->dots;
+        size_t toggles=0;
+        for(size_t i=0;i<c.w.size();i++) toggles+=(size_t)__builtin_popcountll(c.w[i]^b.w[i]);
+        put_varint(out,toggles);
+        uint64_t prev=0;
+        for(size_t i=0;i<c.w.size() && toggles;i++){
+            uint64_t x=c.w[i]^b.w[i];
+            while(x){
+                uint64_t pos=(uint64_t)i*64+(uint64_t)__builtin_ctzll(x);
+                put_varint(out,pos-prev); prev=pos;
+                x&=x-1; toggles--;
+            }
+        }
+    }
+}
+
+bool peek_snapshot(const uint8_t* p,const uint8_t* end,uint32_t& tick,uint32_t& base){
+    uint64_t t,b;
+    if(!get_varint(p,end,t) || !get_varint(p,end,b)) return false;
+    tick=(uint32_t)t; base=(uint32_t)b;
+    return true;
+}
+
+bool decode_snapshot(const uint8_t* p,const uint8_t* end,const Snapshot* base,Snapshot& out,uint32_t& input_ack){
+    uint64_t t,b,a,v;
+    if(!get_varint(p,end,t) || !get_varint(p,end,b) || !get_varint(p,end,a) || p>=end) return false;
+    if(b){
+        if(!base || base->tick!=b || base==&out) return false;
+        out=*base;
+    }
+    out.tick=(uint32_t)t; input_ack=(uint32_t)a;
+    uint8_t mask=*p++;
+    if(!b && (mask&(F_GHOSTS_FULL|F_PLANES_FULL))!=(F_GHOSTS_FULL|F_PLANES_FULL)) return false;
+
+    auto get_i=[&](int32_t& dst){ if(!get_varint(p,end,v)) return false; dst=(int32_t)unzigzag(v); return true; };
+    auto get_b=[&](uint8_t& dst){ if(p>=end) return false; dst=*p++; return true; };
+    auto get_u16=[&](int16_t& dst){ if(!get_varint(p,end,v) || v>0xFFFF) return false; dst=(int16_t)v; return true; };
+    if(mask&F_PAC){
+        uint8_t d;
+        if(!get_i(out.px) || !get_i(out.py) || !get_b(d) || d>8) return false;
+        out.pdx=d/3-1; out.pdy=d%3-1;
+    }
+    if((mask&F_SCORE) && !get_i(out.score)) return false;
+    if((mask&F_LIVES) && !get_i(out.lives)) return false;
+    if((mask&F_TOKENS) && !get_i(out.tokens)) return false;
+    if((mask&F_POWER) && !get_b(out.power)) return false;
+    if((mask&F_OVER) && !get_b(out.over)) return false;
+
+    if(mask&F_GHOSTS_FULL){
+        uint64_t n;
+        if(!get_varint(p,end,n) || n>MAX_GHOSTS) return false;
+        out.gx.resize(n); out.gy.resize(n); out.gin.resize(n);
+        for(size_t i=0;i<n;i++) if(!get_u16(out.gx[i]) || !get_u16(out.gy[i]) || !get_b(out.gin[i])) return false;
+    }else{
+        uint64_t changed; size_t n=out.gx.size(), i=0;
+        if(!get_varint(p,end,changed) || changed>n) return false;
+        for(uint64_t k=0;k<changed;k++){
+            uint8_t code;
+            if(!get_varint(p,end,v) || (k && v==0) || (i+=v)>=n || !get_b(code) || code>9) return false;
+            if(code==0){ if(!get_u16(out.gx[i]) || !get_u16(out.gy[i]) || !get_b(out.gin[i])) return false; }
+            else { out.gx[i]=(int16_t)(out.gx[i]+(code-1)/3-1); out.gy[i]=(int16_t)(out.gy[i]+(code-1)%3-1); }
+        }
+    }
+
+    for(int k=0;k<2;k++){
+        BitPlane& pl= k? out.pellets : out.dots;
+        if(mask&F_PLANES_FULL){
+            if(!get_varint(p,end,v) || v!=pl.w.size() || (uint64_t)(end-p)<v*8) return false;
+            memcpy(pl.w.data(),p,v*8); p+=v*8;
+            continue;
+        }
+        uint64_t toggles, pos=0, bits=(uint64_t)pl.w.size()*64;
+        if(!get_varint(p,end,toggles)) return false;
+        for(uint64_t j=0;j<toggles;j++){
+            if(!get_varint(p,end,v) || (j && v==0) || (pos+=v)>=bits) return false;
+            pl.w[pos>>6]^=(uint64_t)1<<(pos&63);
+        }
+    }
+    return p==end;
+}
+
+// ============================================================================
+// Host
+// ============================================================================
+bool Host::listen(int port_,std::string* err){
+    listen_fd=socket(AF_INET,SOCK_STREAM|SOCK_CLOEXEC,0);
+    if(listen_fd<0){ if(err) *err=strerror(errno); return false; }
+    int one=1; setsockopt(listen_fd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof one);
+    sockaddr_in a{}; a.sin_family=AF_INET; a.sin_addr.s_addr=htonl(INADDR_ANY); a.sin_port=htons((uint16_t)port_);
+    if(bind(listen_fd,(sockaddr*)&a,sizeof a)!=0 || ::listen(listen_fd,1)!=0){
+        if(err) *err=strerror(errno);
+        ::close(listen_fd); listen_fd=-1; return false;
+    }
+    return true;
+}
+
+int Host::port() const {
+    sockaddr_in a{}; socklen_t n=sizeof a;
+    if(listen_fd<0 || getsockname(listen_fd,(sockaddr*)&a,&n)!=0) return -1;
+    return ntohs(a.sin_port);
+}
+
+bool Host::accept_client(const Maze& m,GameMode mode,int ghosts,int tick_us,int timeout_ms,std::string* err){
+    pollfd pf{listen_fd,POLLIN,0};
+    int r;
+    do r=poll(&pf,1,timeout_ms); while(r<0 && errno==EINTR);
+    if(r<=0){ if(err) *err= r==0? "nadie se conectó" : strerror(errno); return false; }
+    fd=accept4(listen_fd,nullptr,nullptr,SOCK_CLOEXEC);
+    if(fd<0){ if(err) *err=strerror(errno); return false; }
+    set_nodelay(fd);
+
+    std::vector<uint8_t> hello;
+    if(!wait_frame(fd,in,MSG_HELLO,hello,timeout_ms) || hello.empty() || hello[0]!=PROTO_VERSION){
+        if(err) *err="saludo inválido (versión distinta?)";
+        close(); return false;
+    }
+    std::vector<uint8_t> lv=level::encode(m);
+    body.clear();
+    body.push_back(PROTO_VERSION); body.push_back((uint8_t)mode);
+    put_varint(body,(uint64_t)std::max(tick_us,0)); put_varint(body,(uint64_t)ghosts);
+    put_varint(body,lv.size()); body.insert(body.end(),lv.begin(),lv.end());
+    put_frame(out,MSG_WELCOME,body);
+    // El nivel puede ser grande: se espera a que salga todo antes de jugar
+    while(!out.empty()){
+        if(!write_some(fd,out)){ if(err) *err="el cliente cortó"; close(); return false; }
+        if(!out.empty()){ pollfd w{fd,POLLOUT,0}; poll(&w,1,timeout_ms); }
+    }
+    acked=input_seq=applied_seq=0; cmd_new=closed=false;
+    return true;
+}
+
+void Host::read_socket(){
+    if(fd<0 || closed) return;
+    if(!read_some(fd,in)) closed=true;
+    bool ok=drain_frames(in,[&](MsgType t,const uint8_t* p,const uint8_t* e){
+        uint64_t v;
+        if(t==MSG_INPUT){
+            if(!get_varint(p,e,v) || p>=e || *p<1 || *p>4) return false;
+            input_seq=(uint32_t)v; cmd_dx=DIRS[*p-1][0]; cmd_dy=DIRS[*p-1][1]; cmd_new=true;
+        }else if(t==MSG_ACK){
+            if(!get_varint(p,e,v)) return false;
+            acked=std::max(acked,(uint32_t)v);
+        }else if(t==MSG_BYE) closed=true;
+        return true;
+    });
+    if(!ok) closed=true;
+}
+
+void Host::flush(){
+    if(fd>=0 && !closed && !out.empty() && !write_some(fd,out)) closed=true;
+}
+
+void Host::poll_input(TickInput& ti){
+    read_socket();
+    // Como con el teclado: gana la última dirección que llegó en el tick
+    if(cmd_new){ ti.bdx=cmd_dx; ti.bdy=cmd_dy; applied_seq=input_seq; cmd_new=false; }
+}
+
+void Host::send_tick(const SimState& s){
+    if(fd<0 || closed) return;
+    flush();
+    if(out.size()>MAX_BACKLOG){ skipped++; return; }
+    Snapshot& cur=hist.slot((uint32_t)s.tick_id);
+    cur.capture(s);
+    const Snapshot* base=hist.find(acked);
+    body.clear();
+    encode_snapshot(cur,base,applied_seq,body);
+    size_t before=out.size();
+    put_frame(out,MSG_SNAPSHOT,body);
+    bytes_sent+=out.size()-before; snapshots++;
+    if(!base) full_snapshots++;
+    flush();
+}
+
+void Host::bye(){
+    if(fd<0 || closed) return;
+    put_frame(out,MSG_BYE,{});
+    flush();
+}
+
+void Host::close(){
+    if(fd>=0){ ::close(fd); fd=-1; }
+    if(listen_fd>=0){ ::close(listen_fd); listen_fd=-1; }
+    closed=true;
+}
+
+// ============================================================================
+// Cliente
+// ============================================================================
+bool Client::connect(const std::string& host,int port,std::string* err){
+    addrinfo hints{}, *res=nullptr;
+    hints.ai_family=AF_UNSPEC; hints.ai_socktype=SOCK_STREAM;
+    std::string ps=std::to_string(port);
+    int rc=getaddrinfo(host.c_str(),ps.c_str(),&hints,&res);
+    if(rc!=0){ if(err) *err=gai_strerror(rc); return false; }
+    for(addrinfo* a=res; a && fd<0; a=a->ai_next){
+        fd=socket(a->ai_family,a->ai_socktype|SOCK_CLOEXEC,a->ai_protocol);
+        if(fd<0) continue;
+        if(::connect(fd,a->ai_addr,a->ai_addrlen)!=0){ ::close(fd); fd=-1; }
+    }
+    if(fd<0 && err) *err=strerror(errno);
+    freeaddrinfo(res);
+    if(fd<0) return false;
+    set_nodelay(fd);
+    return true;
+}
+
+bool Client::handshake(int timeout_ms,std::string* err){
+    auto fail=[&](const char* e){ if(err) *err=e; close(); return false; };
+    put_frame(out,MSG_HELLO,{PROTO_VERSION});
+    flush();
+    std::vector<uint8_t> w;
+    if(!wait_frame(fd,in,MSG_WELCOME,w,timeout_ms)) return fail("el host no respondió");
+    const uint8_t* p=w.data(); const uint8_t* e=p+w.size();
+    uint64_t tu,ng,len;
+    if(e-p<2 || p[0]!=PROTO_VERSION) return fail("versión de protocolo distinta");
+    mode=(GameMode)std::min<int>(p[1],MODE_3); p+=2;
+    if(!get_varint(p,e,tu) || !get_varint(p,e,ng) || !get_varint(p,e,len) || (uint64_t)(e-p)!=len || ng>MAX_GHOSTS)
+        return fail("bienvenida inválida");
+    tick_us=(int)tu; ghosts=(int)ng;
+    std::string lerr;
+    maze=level::decode(p,(size_t)len,&lerr);
+    if(!maze){ lerr="nivel del host: "+lerr; if(err) *err=lerr; close(); return false; }
+    view=std::make_unique<SimState>(maze,ghosts);
+    view->blinky_human=true;
+    return true;
+}
+
+void Client::flush(){
+    if(fd>=0 && !closed && !out.empty() && !write_some(fd,out)) closed=true;
+}
+
+void Client::set_ghost(int i,int x,int y,bool in_house){
+    SimState& v=*view;
+    if(v.gh.x[i]==x && v.gh.y[i]==y && (v.gh.in_house[i]!=0)==in_house) return;
+    if(!v.gh.in_house[i]) v.occ.sub(v.gh.x[i],v.gh.y[i],v.gh.kind[i]);
+    v.gh.x[i]=(int16_t)x; v.gh.y[i]=(int16_t)y; v.gh.in_house[i]=in_house;
+    if(!in_house) v.occ.add(x,y,v.gh.kind[i]);
+}
+
+// Lo mismo que hará ghost_step en el host con el comando de Blinky
+void Client::predict(const Pending& pd){
+    SimState& v=*view;
+    if(v.gh.n==0 || v.gh.in_house[0]) return;
+    int nx=v.gh.x[0]+pd.dx, ny=v.gh.y[0]+pd.dy; v.wrap(nx,ny);
+    if(!v.solid_for_ghost(nx,ny)) set_ghost(0,nx,ny,false);
+}
+
+void Client::send_input(int dx,int dy){
+    if(fd<0 || closed) return;
+    int d=0;
+    for(int i=0;i<4;i++) if(DIRS[i][0]==dx && DIRS[i][1]==dy) d=i+1;
+    if(!d) return;
+    Pending pd{++seq,(int8_t)dx,(int8_t)dy,now_ns()};
+    std::vector<uint8_t> b; put_varint(b,pd.seq); b.push_back((uint8_t)d);
+    put_frame(out,MSG_INPUT,b);
+    flush();
+    pending.push_back(pd);
+    predict(pd);
+}
+
+// Foto autoritativa + lo que el host todavía no aplicó
+void Client::apply(const Snapshot& s,uint32_t ack){
+    SimState& v=*view;
+    v.tick_id=(int)s.tick;
+    v.px=s.px; v.py=s.py; v.pdx=s.pdx; v.pdy=s.pdy;
+    v.score=s.score; v.lives=s.lives; v.tokens=s.tokens; v.power=s.power!=0;
+    v.dots=s.dots; v.pellets=s.pellets;
+    for(int i=0;i<v.gh.n && i<(int)s.gx.size();i++) set_ghost(i,s.gx[(size_t)i],s.gy[(size_t)i],s.gin[(size_t)i]!=0);
+    over=s.over!=0;
+
+    uint64_t now=now_ns();
+    size_t keep=0;
+    for(const Pending& pd: pending){
+        if(pd.seq<=ack){ uint64_t d=now-pd.t; latency_ns.push_back(d>UINT32_MAX? UINT32_MAX : (uint32_t)d); }
+        else pending[keep++]=pd;
+    }
+    pending.resize(keep);
+    acked_input=std::max(acked_input,ack);
+    for(const Pending& pd: pending) predict(pd);
+}
+
+bool Client::pump(int timeout_ms){
+    if(fd<0 || closed) return false;
+    pollfd pf{fd,POLLIN,0};
+    int r=poll(&pf,1,timeout_ms);
+    if(r<0 && errno!=EINTR){ closed=true; return false; }
+    if(r>0 && !read_some(fd,in,&bytes_recv)) closed=true;
+    bool got=false;
+    bool ok=drain_frames(in,[&](MsgType t,const uint8_t* p,const uint8_t* e){
+        if(t==MSG_BYE){ closed=true; return true; }
+        if(t!=MSG_SNAPSHOT) return true;
+        uint32_t tick,btick,ack;
+        if(!peek_snapshot(p,e,tick,btick) || tick<=last_tick) return false;
+        Snapshot& cur=hist.slot(tick);
+        if(cur.dots.W==0){ cur.dots.init(maze->W,maze->H); cur.pellets.init(maze->W,maze->H); }
+        if(!decode_snapshot(p,e,btick? hist.find(btick) : nullptr,cur,ack)) return false;
+        last_tick=tick; snapshots++;
+        if(!btick) full_snapshots++;
+        apply(cur,ack);
+        got=true;
+        return true;
+    });
+    if(!ok) closed=true;
+    if(got){
+        std::vector<uint8_t> b; put_varint(b,last_tick);
+        put_frame(out,MSG_ACK,b);
+        flush();
+    }
+    return got;
+}
+
+void Client::bye(){
+    if(fd<0 || closed) return;
+    put_frame(out,MSG_BYE,{});
+    flush();
+}
+
+void Client::close(){
+    if(fd>=0){ ::close(fd); fd=-1; }
+    closed=true;
+}
+
+// Maneja a Blinky (WASD) viendo la foto del host; 'q' sale
+int client_game(const std::string& addr){
+    size_t colon=addr.rfind(':');
+    std::string host= colon==std::string::npos? addr : addr.substr(0,colon);
+    int port= colon==std::string::npos? DEFAULT_PORT : atoi(addr.c_str()+colon+1);
+    if(host.empty()) host="127.0.0.1";
+
+    Client c; std::string err;
+    if(!c.connect(host,port,&err) || !c.handshake(10000,&err)){
+        fprintf(stderr,"no se pudo conectar a %s:%d: %s\n",host.c_str(),port,err.c_str());
+        return 1;
+    }
+    g_renderer.invalidate(); g_renderer.reset_stats();
+    {
+        keys::RawGuard rg;
+        unsigned char buf[64]; size_t have=0;
+        bool quit=false;
+        auto draw=[&](){
+            char hud[128];
+            std::vector<uint32_t> v=c.latency_ns;
+            std::sort(v.begin(),v.end());
+            double p50= v.empty()? 0 : v[(v.size()-1)/2]/1e6;
+            snprintf(hud,sizeof hud,"Blinky en red | tick %u | %.1f ms entrada->host | %.0f bytes/tick",
+                     c.last_tick,p50,c.snapshots? (double)c.bytes_recv/c.snapshots : 0.0);
+            g_renderer.hud=hud;
+            render_locked(*c.view);
+        };
+        while(!quit && !c.closed && !c.over){
+            pollfd p[2]={{STDIN_FILENO,POLLIN,0},{c.fd,POLLIN,0}};
+            if(poll(p,2,-1)<0){ if(errno==EINTR) continue; break; }
+            bool dirty=false;
+            if(p[0].revents&POLLIN){
+                ssize_t n=::read(STDIN_FILENO,buf+have,sizeof(buf)-have);
+                if(n<=0 && !(n<0 && (errno==EINTR||errno==EAGAIN))) break;
+                if(n>0) have+=(size_t)n;
+                size_t used=keys::decode_all(buf,have,[&](keys::Key k){
+                    int dx=0,dy=0;
+                    if(k==keys::QUIT) quit=true;
+                    else if(blinky_command(k,dx,dy)){ c.send_input(dx,dy); dirty=true; }
+                });
+                memmove(buf,buf+used,have-used); have-=used;
+            }
+            if(p[1].revents && c.pump(0)) dirty=true;
+            if(dirty) draw();
+        }
+        c.bye();
+    }
+    g_renderer.hud.clear();
+
+    std::vector<uint32_t> v=c.latency_ns;
+    std::sort(v.begin(),v.end());
+    printf("\n");
+    term::println_center(term::bold(c.over? "Partida terminada" : "Desconectado"));
+    term::println_center("Puntaje de Pac-Man: "+std::to_string(c.view->score));
+    char st[160];
+    snprintf(st,sizeof st,"Red: %llu fotos (%llu completas) | %.0f bytes/tick",
+             (unsigned long long)c.snapshots,(unsigned long long)c.full_snapshots,
+             c.snapshots? (double)c.bytes_recv/c.snapshots : 0.0);
+    term::println_center(term::dim(st));
+    if(!v.empty()){
+        snprintf(st,sizeof st,"Entrada -> foto del host: p50 %.1f ms | p99 %.1f ms | %zu teclas",
+                 v[(v.size()-1)/2]/1e6,v[(size_t)((v.size()-1)*0.99)]/1e6,v.size());
+        term::println_center(term::dim(st));
+    }
+    return 0;
+}
+
+} // namespace net
@@ -0,0 +1,132 @@
+#pragma once
+// Modo 3 en red: host autoritativo y cliente que maneja a Blinky (TCP)
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "game.hpp"
+#include "engine.hpp"
+
+// ============================================================================
+// Red: protocolo
+// ============================================================================
+// Mensajes: varint largo + tipo + cuerpo. El host manda WELCOME (modo, tick,
+// fantasmas y el nivel en binario PMLV) y después un SNAPSHOT por tick: delta
+// contra la última foto que el cliente confirmó con ACK (fichas que cambiaron,
+// fantasmas que se movieron, Pac-Man y marcador solo si cambiaron), o completa
+// si esa foto ya no está en el historial. El cliente manda INPUT (secuencia +
+// dirección de Blinky) apenas se aprieta la tecla y mueve a Blinky en su copia
+// (predicción); cuando llega la foto que confirma esa secuencia se vuelve a la
+// versión del host y se re-aplica solo lo que sigue pendiente.
+namespace net {
+
+constexpr int DEFAULT_PORT=7777;
+constexpr uint8_t PROTO_VERSION=1;
+constexpr int HISTORY=32;           // fotos guardadas para armar/aplicar deltas
+
+enum MsgType : uint8_t { MSG_HELLO=1, MSG_WELCOME=2, MSG_INPUT=3, MSG_SNAPSHOT=4, MSG_ACK=5, MSG_BYE=6 };
+
+// Lo que el cliente necesita para dibujar (no toda la simulación)
+struct Snapshot {
+    uint32_t tick=0;                    // 0 = vacía
+    int32_t px=0, py=0, pdx=0, pdy=0;
+    int32_t score=0, lives=0, tokens=0;
+    uint8_t power=0, over=0;
+    std::vector<int16_t> gx, gy;
+    std::vector<uint8_t> gin;           // 1 = en la casa
+    BitPlane dots, pellets;
+
+    void capture(const SimState& s);
+};
+
+// Fotos por tick en un anillo (host: las enviadas; cliente: las recibidas)
+struct History {
+    Snapshot ring[HISTORY];
+    const Snapshot* find(uint32_t tick) const {
+        const Snapshot& s=ring[tick%HISTORY];
+        return (tick && s.tick==tick)? &s : nullptr;
+    }
+    Snapshot& slot(uint32_t tick){ return ring[tick%HISTORY]; }
+};
+
+// Host con más de esto sin escribir en el socket salta la foto del tick
+constexpr size_t MAX_BACKLOG=256*1024;
+
+// Cuerpo de SNAPSHOT: delta de cur contra base (nullptr = completa)
+void encode_snapshot(const Snapshot& cur,const Snapshot* base,uint32_t input_ack,std::vector<uint8_t>& out);
+// Tick y base (0 = completa) sin decodificar el resto
+bool peek_snapshot(const uint8_t* p,const uint8_t* end,uint32_t& tick,uint32_t& base);
+// out ya dimensionado (planos y fantasmas) si la foto es completa
+bool decode_snapshot(const uint8_t* p,const uint8_t* end,const Snapshot* base,Snapshot& out,uint32_t& input_ack);
+
+// ============================================================================
+// Host: la partida corre acá; Blinky llega por la red
+// ============================================================================
+struct Host {
+    int listen_fd=-1, fd=-1;
+    std::vector<uint8_t> in, out, body;     // out = lo que falta escribir en el socket
+    History hist;
+    uint32_t acked=0;                       // última foto confirmada por el cliente
+    uint32_t input_seq=0;                   // última entrada recibida (aún no aplicada)
+    uint32_t applied_seq=0;                 // última entrada aplicada en un tick
+    int cmd_dx=0, cmd_dy=0;
+    bool cmd_new=false, closed=false;
+    uint64_t skipped=0;                     // ticks sin foto (el cliente no lee)
+
+    uint64_t bytes_sent=0, snapshots=0, full_snapshots=0;
+
+    ~Host(){ close(); }
+    bool listen(int port,std::string* err);     // port 0 = efímero
+    int port() const;
+    // Espera al cliente y le manda WELCOME
+    bool accept_client(const Maze& m,GameMode mode,int ghosts,int tick_us,int timeout_ms,std::string* err);
+    // En cada tick (hilo de Pac-Man): entrada remota y foto del estado
+    void poll_input(TickInput& in);
+    void send_tick(const SimState& s);
+    void bye();
+    void close();
+private:
+    void read_socket();
+    void flush();
+};
+
+// ============================================================================
+// Cliente: dibuja la foto del host y manda las teclas de Blinky
+// ============================================================================
+struct Client {
+    int fd=-1;
+    std::shared_ptr<const Maze> maze;
+    GameMode mode=MODE_3;
+    int ghosts=0, tick_us=0;
+    std::vector<uint8_t> in, out;
+    History hist;
+    uint32_t last_tick=0, acked_input=0;
+    std::unique_ptr<SimState> view;         // foto + predicción (lo que se dibuja)
+    struct Pending { uint32_t seq; int8_t dx, dy; uint64_t t; };
+    std::vector<Pending> pending;
+    uint32_t seq=0;
+    bool over=false, closed=false;
+
+    uint64_t bytes_recv=0, snapshots=0, full_snapshots=0;
+    std::vector<uint32_t> latency_ns;       // tecla -> foto del host que la incluye
+
+    ~Client(){ close(); }
+    bool connect(const std::string& host,int port,std::string* err);
+    bool handshake(int timeout_ms,std::string* err);   // HELLO -> WELCOME
+    // Manda la dirección y la aplica ya en la copia local
+    void send_input(int dx,int dy);
+    // Lee lo que haya (espera hasta timeout_ms); true si llegó al menos una foto
+    bool pump(int timeout_ms);
+    void bye();
+    void close();
+private:
+    void apply(const Snapshot& s,uint32_t ack);
+    void predict(const Pending& p);
+    void set_ghost(int i,int x,int y,bool in_house);
+    void flush();
+};
+
+// Se conecta a host:puerto y maneja a Blinky con WASD
+int client_game(const std::string& addr);
+
+} // namespace net
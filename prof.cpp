@@ -0,0 +1,63 @@
+#include <algorithm>
+#include "prof.hpp"
+
+namespace prof {
+
+bool enabled=false;
+Stats g;
+
+uint64_t Histogram::percentile(double p) const {
+    uint64_t total=n.load(std::memory_order_relaxed);
+    if(total==0) return 0;
+    uint64_t want=(uint64_t)(p*(total-1))+1, acc=0;
+    for(int i=0;i<BUCKETS;i++){
+        acc+=b[i].load(std::memory_order_relaxed);
+        if(acc>=want){
+            uint64_t lo=lower(i), hi= i+1<BUCKETS? lower(i+1) : lo;
+            return std::min(lo+(hi-lo)/2,max.load(std::memory_order_relaxed));
+        }
+    }
+    return max.load(std::memory_order_relaxed);
+}
+
+void reset(){
+    for(Histogram& h: g.h) h.clear();
+    g.lock_acquired=0; g.lock_contended=0;
+    g.started_ns=now_ns();
+}
+
+std::string hud_line(){
+    static const Phase shown[]={INPUT_LAG,TICK_WAIT,GHOST_AI,COLLIDE,RENDER};
+    static const char* tag[]={"lag","wait","ai","col","ren"};
+    char buf[160]; int n=snprintf(buf,sizeof(buf),"p99 us:");
+    for(int i=0;i<5;i++)
+        n+=snprintf(buf+n,sizeof(buf)-n," %s %.0f",tag[i],g.h[shown[i]].percentile(0.99)/1000.0);
+    snprintf(buf+n,sizeof(buf)-n," | tick %.1f ms jit %.1f ms",
+             g.h[TICK_PERIOD].percentile(0.5)/1e6,g.h[JITTER].percentile(0.99)/1e6);
+    return buf;
+}
+
+void dump(FILE* f,int tick_us){
+    double secs=(now_ns()-g.started_ns)/1e9;
+    fprintf(f,"# perfil por fase (%.1f s, TICK_US=%d)\n",secs,tick_us);
+    fprintf(f,"%-12s %10s %12s %12s %12s %12s %12s\n","fase","n","media_us","p50_us","p99_us","max_us","total_ms");
+    for(int i=0;i<NUM_PHASES;i++){
+        const Histogram& h=g.h[i];
+        uint64_t k=h.n.load();
+        if(k==0) continue;
+        fprintf(f,"%-12s %10llu %12.2f %12.2f %12.2f %12.2f %12.2f\n",PHASE_NAMES[i],(unsigned long long)k,
+                h.mean()/1000.0,h.percentile(0.5)/1000.0,h.percentile(0.99)/1000.0,h.max.load()/1000.0,h.sum.load()/1e6);
+    }
+    uint64_t acq=g.lock_acquired.load(), cont=g.lock_contended.load();
+    fprintf(f,"mutex: %llu adquisiciones, %llu con contención (%.1f%%)\n",
+            (unsigned long long)acq,(unsigned long long)cont,acq? 100.0*cont/acq : 0.0);
+}
+
+bool dump_file(const std::string& path,int tick_us){
+    FILE* f=fopen(path.c_str(),"w");
+    if(!f) return false;
+    dump(f,tick_us);
+    return fclose(f)==0;
+}
+
+} // namespace prof
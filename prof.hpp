@@ -0,0 +1,121 @@
+#pragma once
+// Instrumentación por fase del tick: histogramas de latencia y uso del mutex
+#include <atomic>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <pthread.h>
+#include "term.hpp"
+
+// ============================================================================
+// Perfilado de fases (desactivado => una lectura de bool por punto de medida)
+// ============================================================================
+namespace prof {
+
+enum Phase {
+    INPUT,        // resolver la entrada del tick (vaciar la cola)
+    INPUT_LAG,    // desde que llega la tecla aplicada hasta el tick que la aplica
+    TICK_WAIT,    // Pac-Man esperando a que terminen los fantasmas
+    GHOST_AI,     // un paso de un fantasma
+    COLLIDE,      // handle_collisions
+    RENDER,       // render_locked
+    SLEEP,        // espera al próximo tick (deadline fijo)
+    LOCK_WAIT,    // esperando GameState::mtx
+    LOCK_HOLD,    // con GameState::mtx tomado
+    TICK_PERIOD,  // intervalo real entre ticks
+    JITTER,       // |intervalo - TICK_US|
+    NUM_PHASES
+};
+inline constexpr const char* PHASE_NAMES[NUM_PHASES]={
+    "input","input_lag","tick_wait","ghost_ai","collide","render","sleep","lock_wait","lock_hold","tick_period","jitter"
+};
+
+// Histograma log-lineal en ns: 8 sub-buckets por potencia de 2 (error < 12.5%).
+// Contadores atómicos relajados: los fantasmas escriben GHOST_AI en paralelo.
+struct Histogram {
+    static constexpr int BUCKETS=16+60*8;
+    std::atomic<uint32_t> b[BUCKETS];
+    std::atomic<uint64_t> n{0}, sum{0}, max{0};
+
+    Histogram(){ clear(); }
+    static int bucket(uint64_t v){
+        if(v<16) return (int)v;
+        int e=63-__builtin_clzll(v);
+        return 16+(e-4)*8+(int)((v>>(e-3))&7);
+    }
+    static uint64_t lower(int i){
+        if(i<16) return (uint64_t)i;
+        int e=(i-16)/8+4, m=(i-16)%8;
+        return (uint64_t)(8+m)<<(e-3);
+    }
+    void add(uint64_t v){
+        b[bucket(v)].fetch_add(1,std::memory_order_relaxed);
+        n.fetch_add(1,std::memory_order_relaxed);
+        sum.fetch_add(v,std::memory_order_relaxed);
+        uint64_t m=max.load(std::memory_order_relaxed);
+        while(v>m && !max.compare_exchange_weak(m,v,std::memory_order_relaxed)) {}
+    }
+    void clear(){
+        for(auto& x: b) x.store(0,std::memory_order_relaxed);
+        n=0; sum=0; max=0;
+    }
+    // Percentil aproximado (centro del bucket), acotado por el máximo real
+    uint64_t percentile(double p) const;
+    double mean() const { uint64_t k=n.load(); return k? (double)sum.load()/k : 0.0; }
+};
+
+struct Stats {
+    Histogram h[NUM_PHASES];
+    std::atomic<uint64_t> lock_acquired{0}, lock_contended{0};
+    uint64_t started_ns=0;
+};
+
+extern bool enabled;   // se fija antes de lanzar los hilos; no cambia durante la partida
+extern Stats g;
+
+void reset();
+inline void add(Phase p,uint64_t ns){ g.h[p].add(ns); }
+
+// Mide el bloque hasta el fin del scope
+struct Scope {
+    Phase p; uint64_t t0;
+    explicit Scope(Phase ph): p(ph), t0(enabled? now_ns() : 0) {}
+    ~Scope(){ if(t0) add(p,now_ns()-t0); }
+};
+
+// Envolturas de GameState::mtx: espera, contención y tiempo con el lock tomado.
+// El inicio de la tenencia es por hilo (cada hilo toma el mutex a lo sumo una vez).
+inline thread_local uint64_t held_since=0;
+inline void lock(pthread_mutex_t* m){
+    if(!enabled){ pthread_mutex_lock(m); return; }
+    g.lock_acquired.fetch_add(1,std::memory_order_relaxed);
+    uint64_t t=now_ns();
+    if(pthread_mutex_trylock(m)!=0){
+        g.lock_contended.fetch_add(1,std::memory_order_relaxed);
+        pthread_mutex_lock(m);
+    }
+    held_since=now_ns();
+    add(LOCK_WAIT,held_since-t);
+}
+inline void unlock(pthread_mutex_t* m){
+    if(enabled && held_since){ add(LOCK_HOLD,now_ns()-held_since); held_since=0; }
+    pthread_mutex_unlock(m);
+}
+// cond_wait suelta el mutex: no cuenta como tenencia; la espera va a 'wait_phase'
+// (NUM_PHASES = no se registra, p. ej. fantasmas ociosos entre ticks)
+inline void cond_wait(pthread_cond_t* c,pthread_mutex_t* m,Phase wait_phase=NUM_PHASES){
+    if(!enabled){ pthread_cond_wait(c,m); return; }
+    uint64_t t=now_ns();
+    if(held_since) add(LOCK_HOLD,t-held_since);
+    pthread_cond_wait(c,m);
+    held_since=now_ns();
+    if(wait_phase!=NUM_PHASES) add(wait_phase,held_since-t);
+}
+
+// Línea corta para el HUD (p99 por fase, en us)
+std::string hud_line();
+// Tabla completa: n, media, p50, p99, max por fase + contención del mutex
+void dump(FILE* f,int tick_us);
+bool dump_file(const std::string& path,int tick_us);
+
+} // namespace prof
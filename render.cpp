@@ -0,0 +1,175 @@
+#include "render.hpp"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+FrameRenderer g_renderer;
+
+void render_locked(const SimState& s){ g_renderer.draw(s); }
+
+static bool ghost_at(const SimState& s,int x,int y,Cell& out){
+    int k=s.occ.top(x,y);
+    if(k<0) return false;
+    out=ghost_symbol(GHOST_COLORS[k],s.power);
+    return true;
+}
+
+void FrameRenderer::put_line(int row,const char* txt,int visible_len,const char* style){
+    int pad=(cols-visible_len)/2; if(pad<0) pad=0;
+    set_fg(0); move_to(row,1); out+="\x1b[2K";
+    move_to(row,pad+1);
+    if(style){ out+=style; cur_fg=-1; }
+    out+=txt;
+    if(style){ out+="\x1b[0m"; cur_fg=0; }
+}
+
+// Filas fijas alrededor del tablero: título, vacía, (tablero), minimapa,
+// marcador, hud, stats y la del cursor
+static constexpr int CHROME_ROWS=7;
+
+void FrameRenderer::fit_view(const SimState& s,int term_cols,int term_rows){
+    int vw=std::min(s.W,std::max(term_cols,8)), vh=std::min(s.H,std::max(term_rows-CHROME_ROWS,4));
+    if(vw!=W || vh!=H){
+        W=vw; H=vh; valid=false;
+        prev.assign((size_t)W*H,Cell{}); cur.assign((size_t)W*H,Cell{});
+    }
+    // Zona muerta: la cámara solo se corre cuando Pac-Man entra en el cuarto de borde
+    auto follow=[](int cam,int p,int view,int world){
+        int dz=view/4;
+        if(p<cam+dz) cam=p-dz;
+        if(p>cam+view-1-dz) cam=p-(view-1-dz);
+        return std::max(0,std::min(world-view,cam));
+    };
+    cam_x=follow(cam_x,s.px,W,s.W);
+    cam_y=follow(cam_y,s.py,H,s.H);
+}
+
+void FrameRenderer::build_cells(const SimState& s){
+    // Solo la ventana: planos de bits y ocupación se consultan por celda en O(1)
+    for(int vy=0;vy<H;vy++){
+        Cell* row=&cur[(size_t)vy*W];
+        int y=cam_y+vy;
+        for(int vx=0;vx<W;vx++){
+            int x=cam_x+vx;
+            Cell c;
+            if(x==s.px && y==s.py) c={'C',93}; // Pac-Man visible
+            else if(!ghost_at(s,x,y,c)) c=color_cell(s.live_cell(x,y));
+            row[vx]=c;
+        }
+    }
+}
+
+void FrameRenderer::build_minimap(const SimState& s){
+    // Una columna de la línea = una franja de columnas del laberinto: '=' la
+    // ventana, 'C' Pac-Man; al final la fila visible sobre el alto total
+    int n=std::max(8,std::min(cols-24,64));
+    mini.assign((size_t)n+2,'-');
+    mini.front()='['; mini.back()=']';
+    int a=(int)((int64_t)cam_x*n/s.W), b=(int)((int64_t)(cam_x+W-1)*n/s.W);
+    for(int i=a;i<=b && i<n;i++) mini[(size_t)i+1]='=';
+    mini[(size_t)std::min(n-1,(int)((int64_t)s.px*n/s.W))+1]='C';
+    char tail[48];
+    snprintf(tail,sizeof(tail)," filas %d-%d/%d",cam_y+1,cam_y+H,s.H);
+    mini+=tail;
+}
+
+static constexpr int TOP=3; // fila 1: título, fila 2: vacía
+
+void FrameRenderer::emit_grid(){
+    out+="\x1b[0m\x1b[2J\x1b[H"; cur_fg=0;
+    put_line(1,"=== PAC-MAN ===",15,"\x1b[1m");
+    for(int y=0;y<H;y++){
+        move_to(TOP+y,margin+1);
+        const Cell* row=&cur[(size_t)y*W];
+        for(int x=0;x<W;x++) put_cell(row[x]);
+    }
+}
+
+void FrameRenderer::build_full(std::string& dst,const char* status,int status_len){
+    out.swap(dst); out.clear();
+    int saved_fg=cur_fg; cur_fg=-1;
+    emit_grid();
+    if(minimap) put_line(TOP+H,mini.c_str(),(int)mini.size(),"\x1b[2m");
+    put_line(TOP+H+1,status,status_len,nullptr);
+    put_line(TOP+H+2,hud.c_str(),(int)hud.size(),"\x1b[2m");
+    set_fg(0);
+    move_to(TOP+H+4,1);
+    out.swap(dst); cur_fg=saved_fg;
+}
+
+void FrameRenderer::draw(const SimState& s){
+    uint64_t t0=now_ns();
+    bool resized= fixed_cols>0? false : term::refresh_size();
+    int new_cols= fixed_cols>0? fixed_cols : term::cached_cols;
+    if(resized || new_cols!=cols) valid=false;
+    cols=new_cols;
+    fit_view(s,cols,fixed_rows>0? fixed_rows : term::cached_rows);
+    margin=(cols-W)/2; if(margin<0) margin=0;
+
+    out.clear(); cur_fg=-1;
+    build_cells(s);
+
+    const int top=TOP;
+    if(!valid){
+        emit_grid();
+        status_prev[0]=0;
+    }else{
+        // Solo celdas cambiadas; huecos cortos se reescriben en vez de mover el cursor
+        for(int y=0;y<H;y++){
+            const Cell* row=&cur[(size_t)y*W];
+            const Cell* old=&prev[(size_t)y*W];
+            int x=0;
+            while(x<W){
+                if(row[x]==old[x]){ x++; continue; }
+                move_to(top+y,margin+x+1);
+                int end=x;
+                while(end<W){
+                    if(row[end]!=old[end]){ put_cell(row[end]); end++; continue; }
+                    int gap=end; while(gap<W && gap-end<4 && row[gap]==old[gap]) gap++;
+                    if(gap<W && gap-end<4 && row[gap]!=old[gap]){ while(end<gap){ put_cell(row[end]); end++; } }
+                    else break;
+                }
+                x=end;
+            }
+        }
+    }
+
+    if(minimap){
+        build_minimap(s);
+        if(!valid || mini!=mini_prev){ put_line(top+H,mini.c_str(),(int)mini.size(),"\x1b[2m"); mini_prev=mini; }
+    }
+    // Marcador (solo si cambió)
+    char status[128];
+    int n=snprintf(status,sizeof(status),"Puntos: %d | Vidas: %d%s",s.score,s.lives,s.power?" | POWER!":"");
+    if(strcmp(status,status_prev)!=0){
+        put_line(top+H+1,status,n,nullptr);
+        memcpy(status_prev,status,sizeof(status));
+    }
+    if(!valid || hud!=hud_prev){
+        put_line(top+H+2,hud.c_str(),(int)hud.size(),"\x1b[2m");
+        hud_prev=hud;
+    }
+    if(show_stats){
+        char st[96];
+        int m=snprintf(st,sizeof(st),"frame: %llu bytes | %.1f us",(unsigned long long)last_bytes,last_ns/1000.0);
+        put_line(top+H+3,st,m,"\x1b[2m");
+    }
+    set_fg(0);
+    move_to(top+H+4,1); // cursor debajo del tablero para los mensajes finales
+
+    if(out_fd>=0){
+        std::cout.flush();
+        term::write_all(out_fd,out.data(),out.size());
+    }
+    // Grabación: el mismo diff, o un frame completo si hace falta (sin I/O acá)
+    if(rec && rec->active()){
+        if(rec->wants_full()){ build_full(rec_out,status,n); rec->frame(rec_out.data(),rec_out.size()); }
+        else rec->frame(out.data(),out.size());
+    }
+    prev.swap(cur);
+    valid=true;
+
+    last_ns=now_ns()-t0;
+    last_bytes=out.size();
+    frames++; bytes_total+=last_bytes; ns_total+=last_ns;
+}
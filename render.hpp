@@ -0,0 +1,96 @@
+#pragma once
+// Render de frames por diferencias sobre una grilla de celdas
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "term.hpp"
+#include "game.hpp"
+#include "cast.hpp"
+
+// ============================================================================
+// Render
+// ============================================================================
+// Cada celda del frame se guarda como (glifo, color ANSI); 0 = color por defecto.
+// El frame anterior se conserva para emitir solo las celdas que cambiaron.
+struct Cell {
+    char ch=' '; uint8_t fg=0;
+    bool operator==(const Cell& o) const { return ch==o.ch && fg==o.fg; }
+    bool operator!=(const Cell& o) const { return !(*this==o); }
+};
+
+inline Cell color_cell(char c){
+    switch(c){
+        case '#': return {'#',34};     // azul pared
+        case '.': return {'.',37};     // punto
+        case 'P': return {'P',32};     // power
+        case '-': return {'-',36};     // puerta
+        case ' ': return {' ',0};      // vacío (comido)
+        default:  return {c,0};
+    }
+}
+inline Cell ghost_symbol(int ansiColor, bool frightened){
+    if(frightened) return {'F',34};    // azul cuando huyen
+    return {'F',(uint8_t)ansiColor};
+}
+
+// Si el laberinto no entra en la terminal se dibuja solo una ventana (W x H)
+// que sigue a Pac-Man: cam_x/cam_y es su esquina en el laberinto y solo se
+// mueve cuando Pac-Man sale de la zona central, así el diff no redibuja toda la
+// ventana a cada paso. El costo por frame depende de la ventana, no del mapa.
+struct FrameRenderer {
+    std::vector<Cell> prev, cur;   // frame anterior / actual (H*W, la ventana)
+    int W=0, H=0, margin=0, cols=0;
+    int cam_x=0, cam_y=0;          // esquina de la ventana en el laberinto
+    bool minimap=false;            // línea extra: posición de la ventana en el mapa
+    std::string mini, mini_prev;
+    bool valid=false;              // false => redibujo completo en el próximo frame
+    std::string out;               // buffer de salida reutilizado (sin allocs por frame)
+    int out_fd=STDOUT_FILENO;      // destino del write() por frame (<0: el frame queda en out)
+    int fixed_cols=0, fixed_rows=0; // >0: tamaño propio (sesiones del servidor), no el de la terminal
+    char status_prev[128]={0};
+    int cur_fg=-1;
+
+    // Contadores (último frame y acumulados)
+    uint64_t frames=0, bytes_total=0, ns_total=0;
+    uint64_t last_bytes=0, last_ns=0;
+    bool show_stats=false;
+    std::string hud, hud_prev;     // línea extra opcional bajo el marcador
+    cast::Recorder* rec=nullptr;   // grabación asciicast (--record)
+    std::string rec_out;           // frame completo para la grabación
+
+    void invalidate(){ valid=false; }
+
+    void put_int(int v){
+        char buf[12]; int n=0;
+        if(v==0){ out.push_back('0'); return; }
+        if(v<0){ out.push_back('-'); v=-v; }
+        while(v>0){ buf[n++]=(char)('0'+v%10); v/=10; }
+        while(n>0) out.push_back(buf[--n]);
+    }
+    void move_to(int row,int col){ out+="\x1b["; put_int(row); out.push_back(';'); put_int(col); out.push_back('H'); }
+    void set_fg(int fg){
+        if(fg==cur_fg) return;
+        if(fg==0) out+="\x1b[0m";
+        else { out+="\x1b["; put_int(fg); out.push_back('m'); }
+        cur_fg=fg;
+    }
+    void put_cell(const Cell& c){ set_fg(c.fg); out.push_back(c.ch); }
+    // Línea completa centrada (título / marcador); los estilos no cuentan para el ancho
+    void put_line(int row,const char* txt,int visible_len,const char* style);
+    // Tamaño de ventana para la terminal actual y cámara siguiendo a Pac-Man
+    void fit_view(const SimState& s,int term_cols,int term_rows);
+    void build_cells(const SimState& s);
+    void build_minimap(const SimState& s);
+    // Borra la pantalla y escribe título + tablero completo (cur)
+    void emit_grid();
+    // Frame completo (tablero, minimapa, marcador, hud) en dst, sin tocar el diff
+    void build_full(std::string& dst,const char* status,int status_len);
+    void draw(const SimState& s);
+
+    void reset_stats(){ frames=bytes_total=ns_total=last_bytes=last_ns=0; }
+};
+
+extern FrameRenderer g_renderer;
+
+// Dibuja el estado con el renderer global (el llamador debe tener el estado quieto)
+void render_locked(const SimState& s);
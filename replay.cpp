@@ -0,0 +1,157 @@
+#include "replay.hpp"
+#include "render.hpp"
+#include "level.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace replay {
+
+bool save(const std::string& path,Header h,Recorder& rec){
+    rec.flush_run();
+    h.ticks=rec.ticks;
+    std::vector<uint8_t> out={'P','M','R','P',3};
+    put_varint(out,h.seed); put_varint(out,h.tick_us);
+    out.push_back(h.mode); out.push_back(h.nav);
+    put_varint(out,h.ghosts);
+    put_varint(out,h.level.size()); out.insert(out.end(),h.level.begin(),h.level.end());
+    put_varint(out,h.level_hash);
+    put_varint(out,h.initials.size()); out.insert(out.end(),h.initials.begin(),h.initials.end());
+    put_varint(out,h.ticks); put_varint(out,zigzag(h.score)); put_varint(out,zigzag(h.lives));
+    out.insert(out.end(),rec.runs.begin(),rec.runs.end());
+    put_varint(out,0);
+    FILE* f=fopen(path.c_str(),"wb");
+    if(!f) return false;
+    bool ok=fwrite(out.data(),1,out.size(),f)==out.size();
+    return fclose(f)==0 && ok;
+}
+
+bool load(const std::string& path,Header& h,std::vector<uint8_t>& inputs){
+    std::ifstream f(path,std::ios::binary);
+    if(!f) return false;
+    std::vector<uint8_t> buf((std::istreambuf_iterator<char>(f)),std::istreambuf_iterator<char>());
+    const uint8_t* p=buf.data(); const uint8_t* end=p+buf.size();
+    if(buf.size()<7 || memcmp(p,"PMRP",4)!=0 || p[4]<1 || p[4]>3) return false;
+    int version=p[4];
+    p+=5;
+    uint64_t v;
+    if(!get_varint(p,end,h.seed)) return false;
+    if(!get_varint(p,end,v)) return false;
+    h.tick_us=(uint32_t)v;
+    if(end-p<2) return false;
+    h.mode=*p++; h.nav=*p++;
+    h.ghosts=DEFAULT_GHOSTS;
+    if(version>=2){
+        if(!get_varint(p,end,v)) return false;
+        h.ghosts=(uint32_t)v;
+    }
+    h.level.clear(); h.level_hash=0;
+    if(version>=3){
+        if(!get_varint(p,end,v) || (uint64_t)(end-p)<v) return false;
+        h.level.assign((const char*)p,(size_t)v); p+=v;
+        if(!get_varint(p,end,h.level_hash)) return false;
+    }
+    if(!get_varint(p,end,v) || (uint64_t)(end-p)<v) return false;
+    h.initials.assign((const char*)p,(size_t)v); p+=v;
+    if(!get_varint(p,end,h.ticks)) return false;
+    if(!get_varint(p,end,v)) return false;
+    h.score=unzigzag(v);
+    if(!get_varint(p,end,v)) return false;
+    h.lives=unzigzag(v);
+    inputs.clear(); inputs.reserve((size_t)h.ticks);
+    while(true){
+        uint64_t run;
+        if(!get_varint(p,end,run)) return false;
+        if(run==0) break;
+        if(p>=end || inputs.size()+run>h.ticks) return false;
+        inputs.insert(inputs.end(),(size_t)run,*p++);
+    }
+    return inputs.size()==h.ticks;
+}
+
+bool Player::open_level(std::string* err){
+    if(h.level.empty()){ maze=Maze::builtin(); return true; }
+    maze=level::load(h.level,err);
+    if(!maze) return false;
+    if(maze->hash!=h.level_hash){
+        if(err) *err="el nivel "+h.level+" cambió desde la grabación";
+        maze=nullptr; return false;
+    }
+    return true;
+}
+
+void Player::start(){
+    mode=(GameMode)h.mode;
+    if(!maze) maze=Maze::builtin();
+    st=GameState(maze,(int)h.ghosts); st.blinky_human=(mode==MODE_3); st.initials=h.initials;
+    tick=0; keyframes.clear(); keyframes.push_back(st);
+}
+
+void Player::step(){
+    keys::Key k; int bdx,bdy; decode(in[tick],k,bdx,bdy);
+    apply_tick_input(st,k,bdx,bdy);
+    sim_tick_rest(st,mode);
+    tick++;
+    if(tick%KEYFRAME_EVERY==0 && tick/KEYFRAME_EVERY==keyframes.size()) keyframes.push_back(st);
+}
+
+void Player::seek(size_t t){
+    if(t>in.size()) t=in.size();
+    size_t k=std::min(t/KEYFRAME_EVERY,keyframes.size()-1);
+    if(t<tick || k*KEYFRAME_EVERY>tick){ st=keyframes[k]; tick=k*KEYFRAME_EVERY; }
+    while(tick<t && !done()) step();
+}
+
+int play(const std::string& path,long seek_to,bool verify,bool checksums){
+    Player p;
+    if(!load(path,p.h,p.in)){ fprintf(stderr,"replay inválido: %s\n",path.c_str()); return 1; }
+    std::string err;
+    if(!p.open_level(&err)){ fprintf(stderr,"%s: %s\n",path.c_str(),err.c_str()); return 1; }
+    GhostNav saved_nav=GHOST_NAV; GHOST_NAV=(GhostNav)p.h.nav;
+    p.start();
+    if(seek_to>0) p.seek((size_t)seek_to);
+
+    if(verify){
+        uint64_t t0=now_ns(), chain=0;
+        while(!p.done()){
+            p.step();
+            chain=zobrist::chain(chain,p.st.zhash);
+            if(checksums) printf("%zu %016llx\n",p.tick,(unsigned long long)p.st.zhash);
+        }
+        double dt=(now_ns()-t0)*1e-9;
+        bool ok = p.st.score==p.h.score && p.st.lives==p.h.lives && p.tick==p.h.ticks;
+        printf("%s: %zu ticks en %.3f s (%.0f ticks/s) | puntaje %d (esperado %lld) | vidas %d (esperado %lld) | "
+               "hash %016llx cadena %016llx | %s\n",
+               path.c_str(),p.tick,dt,dt>0? p.tick/dt : 0.0,p.st.score,(long long)p.h.score,
+               p.st.lives,(long long)p.h.lives,(unsigned long long)p.st.zhash,(unsigned long long)chain,ok?"OK":"DIVERGE");
+        GHOST_NAV=saved_nav;
+        return ok? 0 : 2;
+    }
+
+    keys::RawGuard rg;
+    g_renderer.invalidate();
+    double speed=1.0;
+    while(true){
+        char hud[128];
+        snprintf(hud,sizeof(hud),"REPLAY %s | tick %zu/%zu | x%g",p.h.initials.c_str(),p.tick,p.in.size(),speed);
+        g_renderer.hud=hud;
+        render_locked(p.st);
+
+        keys::Key k=keys::read_nowait();
+        if(k==keys::QUIT) break;
+        if(k==keys::RIGHT) p.seek(p.tick+100);
+        if(k==keys::LEFT)  p.seek(p.tick>100? p.tick-100 : 0);
+        if(k==keys::UP)    speed=std::min(speed*2,64.0);
+        if(k==keys::DOWN)  speed=std::max(speed/2,0.125);
+        if(k!=keys::NONE) continue;
+
+        if(!p.done()) p.step();
+        usleep((useconds_t)(p.h.tick_us/speed));
+    }
+    g_renderer.hud.clear();
+    GHOST_NAV=saved_nav;
+    return 0;
+}
+
+} // namespace replay
@@ -0,0 +1,98 @@
+#pragma once
+// Replays: grabación de la entrada por tick y reproducción determinista
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "game.hpp"
+
+// ============================================================================
+// Replays: entrada por tick en RLE + varint, reproducción determinista
+// ============================================================================
+// Archivo: "PMRP" v3, cabecera en varints (semilla, TICK_US, modo, navegación,
+// cantidad de fantasmas, nivel (ruta y hash; ruta vacía = integrado), iniciales,
+// resultado final; v1 no trae fantasmas = 4, v1/v2 no traen nivel = integrado)
+// y luego pares (largo de racha, byte de entrada)
+// terminados en racha 0. Byte de entrada: bits 0-3 tecla de Pac-Man, bits 4-6
+// dirección de Blinky (0 nada, 1+índice en DIRS).
+namespace replay {
+
+inline constexpr const char* DIR_PATH="replays";
+constexpr int KEYFRAME_EVERY=256;
+
+inline void put_varint(std::vector<uint8_t>& out,uint64_t v){
+    while(v>=0x80){ out.push_back((uint8_t)(v|0x80)); v>>=7; }
+    out.push_back((uint8_t)v);
+}
+inline bool get_varint(const uint8_t*& p,const uint8_t* end,uint64_t& v){
+    v=0;
+    for(int shift=0; p<end && shift<64; shift+=7){
+        uint8_t b=*p++; v|=(uint64_t)(b&0x7F)<<shift;
+        if(!(b&0x80)) return true;
+    }
+    return false;
+}
+inline uint64_t zigzag(int64_t v){ return ((uint64_t)v<<1)^(uint64_t)(v>>63); }
+inline int64_t unzigzag(uint64_t v){ return (int64_t)(v>>1)^-(int64_t)(v&1); }
+
+inline uint8_t encode(keys::Key k,int bdx,int bdy){
+    int d=0;
+    for(int i=0;i<4;i++) if(DIRS[i][0]==bdx && DIRS[i][1]==bdy && (bdx||bdy)) d=i+1;
+    return (uint8_t)((int)k | (d<<4));
+}
+inline void decode(uint8_t b,keys::Key& k,int& bdx,int& bdy){
+    k=(keys::Key)(b&0x0F);
+    int d=(b>>4)&0x07;
+    bdx = d? DIRS[d-1][0] : 0; bdy = d? DIRS[d-1][1] : 0;
+}
+
+struct Header {
+    uint64_t seed=0;
+    uint32_t tick_us=0;
+    uint8_t mode=0, nav=0;
+    uint32_t ghosts=DEFAULT_GHOSTS;
+    std::string level;          // "" = laberinto integrado
+    uint64_t level_hash=0;
+    std::string initials;
+    uint64_t ticks=0;
+    int64_t score=0, lives=0;
+};
+
+struct Recorder {
+    std::vector<uint8_t> runs;
+    uint8_t cur=0; uint64_t len=0, ticks=0;
+    void add(uint8_t b){
+        if(len && b==cur){ len++; }
+        else { flush_run(); cur=b; len=1; }
+        ticks++;
+    }
+    void flush_run(){ if(len){ put_varint(runs,len); runs.push_back(cur); len=0; } }
+};
+
+bool save(const std::string& path,Header h,Recorder& rec);
+// Carga cabecera y expande las rachas a un byte por tick
+bool load(const std::string& path,Header& h,std::vector<uint8_t>& inputs);
+
+// Re-simulación sin sleeps; guarda un GameState cada KEYFRAME_EVERY ticks para buscar
+struct Player {
+    Header h;
+    std::vector<uint8_t> in;
+    GameMode mode=MODE_1;
+    std::shared_ptr<const Maze> maze;   // el nivel de la cabecera (lo resuelve open_level)
+    GameState st;
+    size_t tick=0;
+    std::vector<SimState> keyframes;    // keyframes[i] = estado en el tick i*KEYFRAME_EVERY
+
+    // Carga el nivel de la cabecera y comprueba el hash; false + err si no coincide
+    bool open_level(std::string* err);
+    void start();
+    bool done() const { return tick>=in.size() || game_finished(st); }
+    void step();
+    void seek(size_t t);
+};
+
+// Reproductor: --verify re-simula a máxima velocidad y compara el resultado
+// (con checksums, además una línea "tick hash" por tick en stdout); si no,
+// muestra la partida (→/← saltan 100 ticks, ↑/↓ velocidad, q sale).
+int play(const std::string& path,long seek_to,bool verify,bool checksums=false);
+
+} // namespace replay
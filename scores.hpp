@@ -0,0 +1,113 @@
+#pragma once
+// Puntajes: registro binario append-only + índice y estadísticas laterales
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// ============================================================================
+// Puntajes: registro binario append-only + índice lateral
+// ============================================================================
+// scores.bin: registros de 16 bytes, solo se anexan.
+// scores.idx: conteo, MAX/MIN, top-K y mejor puntaje por iniciales; tamaño fijo,
+// se reescribe in situ con pwrite. Guardar es O(1) y lo hace un hilo escritor.
+// scores.stats: conteo, media, varianza y percentiles aproximados, en total,
+// por modo y por iniciales, de las partidas de scores.bin; tamaño fijo y con el
+// id de la máquina. scores.merged: el último scores.stats sumado de cada otra
+// máquina (--merge-stats), uno por id; stats() devuelve lo propio más eso.
+namespace scores {
+
+inline constexpr const char* LOG_PATH="scores.bin";
+inline constexpr const char* IDX_PATH="scores.idx";
+inline constexpr const char* LEGACY_PATH="scores.txt";
+inline constexpr const char* STATS_PATH="scores.stats";
+inline constexpr const char* MERGED_PATH="scores.merged";
+constexpr int TOPK=16;
+constexpr int BEST_SLOTS=1024;   // potencia de 2 (hash abierto)
+constexpr int INI_SLOTS=128;     // potencia de 2; las iniciales que no entran van a "otros"
+
+struct Record {
+    char ini[4];        // iniciales, relleno con '\0'
+    int32_t score;
+    uint32_t time;      // epoch (s); 0 si vino de scores.txt
+    uint8_t mode;       // 1..3; 0 desconocido
+    uint8_t pad[3];
+};
+static_assert(sizeof(Record)==16,"registro de 16 bytes");
+
+struct Entry { char ini[4]; int32_t score; };
+
+struct Index {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    Entry max, min;
+    uint32_t ntop, pad;
+    Entry top[TOPK];            // descendente
+    Entry best[BEST_SLOTS];     // ini[0]==0 => libre
+};
+
+// Histograma log-lineal: valores < SK_SUB exactos; de ahí en más SK_SUB
+// cubetas por potencia de 2 (error relativo <= 1/(2*SK_SUB) tomando el centro).
+// Tamaño fijo, y dos se suman cubeta a cubeta sin perder nada.
+constexpr int SK_SUB=16;
+constexpr int SK_BUCKETS=SK_SUB*(32-4);     // hasta 2^31 (SK_SUB=2^4)
+
+struct Stats {
+    uint64_t n;
+    double mean, m2;            // Welford: m2 = suma de (x-media)^2
+    int32_t min, max;
+    uint32_t sk[SK_BUCKETS];
+
+    void add(int32_t x);
+    void merge(const Stats& o);             // Chan et al.: exacto para media y varianza
+    double var() const { return n? m2/(double)n : 0; }
+    double stddev() const;
+    int32_t quantile(double q) const;       // aproximado (centro de la cubeta)
+};
+
+struct IniStats { char ini[4]; uint32_t pad; Stats st; };   // ini[0]==0 => libre
+
+struct Summary {
+    char magic[4];
+    uint32_t version;
+    uint64_t log_count;         // registros de scores.bin ya sumados
+    uint64_t source;            // id de la máquina (al azar al crear el sidecar; se conserva al reconstruir)
+    uint64_t merged;            // en stats(): partidas de otras máquinas (0 en disco)
+    uint32_t ini_used;          // casillas ocupadas (hasta 3/4: las búsquedas cortan en una libre)
+    uint32_t sources;           // en stats(): otras máquinas sumadas (0 en disco)
+    Stats all;
+    Stats mode[4];              // 0 = desconocido (importado de scores.txt)
+    Stats other;                // iniciales vacías o sin lugar en la tabla
+    IniStats ini[INI_SLOTS];
+};
+
+inline std::string ini_str(const char ini[4]){ return std::string(ini,strnlen(ini,4)); }
+inline void ini_set(char out[4],const std::string& s){ memset(out,0,4); memcpy(out,s.data(),std::min<size_t>(s.size(),4)); }
+
+// Abre (o crea) los archivos y arranca el hilo escritor, que valida (o
+// reconstruye) índice y estadísticas antes de atender la cola; flush() lo
+// espera. Si el registro no existía y hay un scores.txt, lo migra una sola vez.
+void open(bool auto_import=true);
+// O(1): encola el registro; el hilo escritor lo anexa y actualiza el índice
+void submit(const std::string& initials,int score,int mode);
+// Espera a que todo lo encolado esté en disco
+void flush();
+// Vacía la cola, detiene el escritor y cierra; open() puede volver a llamarse
+void shutdown();
+Index snapshot();
+// Copia de las estadísticas (tamaño fijo, no depende de cuántas partidas haya)
+Summary stats();
+// Suma un scores.stats de otra máquina: reemplaza lo sumado antes de esa misma
+// máquina (el propio o uno más viejo no cambian nada). Devuelve partidas nuevas o -1.
+long merge_stats(const char* path);
+// Últimos n registros: lectura posicionada al final del archivo, sin recorrerlo
+std::vector<Record> last(int n);
+// Importa un scores.txt antiguo (ignora los bloques de RESUMEN). Devuelve registros importados.
+long import_legacy(const char* path);
+
+} // namespace scores
+
+// Guarda el puntaje de una partida (asíncrono, O(1)); mode 1..3
+void save_score_and_update_summary(const std::string& initials,int score,int mode);
@@ -0,0 +1,277 @@
+#include "server.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+namespace server {
+
+namespace {
+void* worker_main(void* arg){
+    Server::WorkerArg* a=(Server::WorkerArg*)arg;
+    Server* srv=a->srv;
+    while(true){
+        srv->barrier.arrive_and_wait();     // A: hay ronda nueva (o salir)
+        if(srv->quit) break;
+        srv->work(a->self);
+        srv->barrier.arrive_and_wait();     // B
+    }
+    return nullptr;
+}
+
+bool unix_addr(const std::string& path,sockaddr_un& a,std::string* err){
+    memset(&a,0,sizeof a); a.sun_family=AF_UNIX;
+    if(path.empty() || path.size()>=sizeof a.sun_path){ if(err) *err="ruta de socket inválida"; return false; }
+    memcpy(a.sun_path,path.c_str(),path.size()+1);
+    return true;
+}
+}
+
+Server::Server(const Options& o,std::shared_ptr<const Maze> m): opt(o), maze(std::move(m)){
+    if(opt.chunk<1) opt.chunk=1;
+    int w=opt.workers>0? opt.workers : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    w=std::max(1,w);
+    opt.workers=w;
+    queues.resize((size_t)w);
+    args.resize((size_t)w);
+    for(int k=0;k<w;k++) args[(size_t)k]=WorkerArg{this,k};
+    ep=epoll_create1(EPOLL_CLOEXEC);
+    barrier.init(w);
+    th.resize((size_t)w-1);
+    for(int k=1;k<w;k++) pthread_create(&th[(size_t)k-1],nullptr,worker_main,&args[(size_t)k]);
+}
+
+Server::~Server(){
+    quit=true;
+    if(!th.empty()) barrier.arrive_and_wait();
+    for(pthread_t& t: th) pthread_join(t,nullptr);
+    for(auto& s: sessions) if(s->fd>=0) ::close(s->fd);
+    if(listen_fd>=0){ ::close(listen_fd); unlink(path.c_str()); }
+    if(ep>=0) ::close(ep);
+}
+
+bool Server::listen(const std::string& unix_path,std::string* err){
+    sockaddr_un a;
+    if(!unix_addr(unix_path,a,err)) return false;
+    // Un socket viejo (servidor anterior caído) se reemplaza; otro archivo no
+    struct stat sb;
+    if(stat(unix_path.c_str(),&sb)==0){
+        if(!S_ISSOCK(sb.st_mode)){ if(err) *err="ya existe y no es un socket"; return false; }
+        unlink(unix_path.c_str());
+    }
+    listen_fd=socket(AF_UNIX,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+    if(listen_fd<0){ if(err) *err=strerror(errno); return false; }
+    if(bind(listen_fd,(sockaddr*)&a,sizeof a)!=0 || ::listen(listen_fd,SOMAXCONN)!=0){
+        if(err) *err=strerror(errno);
+        ::close(listen_fd); listen_fd=-1; return false;
+    }
+    path=unix_path;
+    epoll_event ev{}; ev.events=EPOLLIN; ev.data.ptr=nullptr;
+    epoll_ctl(ep,EPOLL_CTL_ADD,listen_fd,&ev);
+    return true;
+}
+
+Session* Server::add(int fd){
+    auto s=std::make_unique<Session>(maze,opt.ghosts);
+    s->fd=fd;
+    s->st.blinky_human=(opt.mode==MODE_3);
+    s->fr.out_fd=-1;
+    s->fr.fixed_cols=opt.cols; s->fr.fixed_rows=opt.rows;
+    s->fr.hud= opt.mode==MODE_3? "flechas: Pac-Man | WASD: Blinky | q: salir" : "flechas: mover | q: salir";
+    epoll_event ev{}; ev.events=EPOLLIN|EPOLLRDHUP; ev.data.ptr=s.get();
+    epoll_ctl(ep,EPOLL_CTL_ADD,fd,&ev);
+    accepted++;
+    sessions.push_back(std::move(s));
+    return sessions.back().get();
+}
+
+// Conexiones nuevas y teclas de todas las sesiones, sin esperar (epoll con 0):
+// solo aparecen los fds con algo para leer, no se recorren las mil sesiones
+void Server::poll_io(){
+    epoll_event evs[256];
+    while(true){
+        int n=epoll_wait(ep,evs,256,0);
+        if(n<0 && errno==EINTR) continue;
+        for(int i=0;i<n;i++){
+            Session* s=(Session*)evs[i].data.ptr;
+            if(!s){
+                int fd;
+                while((fd=accept4(listen_fd,nullptr,nullptr,SOCK_CLOEXEC))>=0) add(fd);
+                continue;
+            }
+            if(s->done) continue;
+            while(true){
+                ssize_t r=recv(s->fd,s->in+s->have,sizeof(s->in)-s->have,MSG_DONTWAIT);
+                if(r<0 && errno==EINTR) continue;
+                if(r<0 && (errno==EAGAIN||errno==EWOULDBLOCK)) break;
+                if(r<=0){ s->done=true; break; }
+                s->have+=(size_t)r;
+                size_t used=keys::decode_all(s->in,s->have,[&](keys::Key k){
+                    if(k==keys::QUIT) s->quit=true;
+                    else if(k==keys::UP||k==keys::DOWN||k==keys::LEFT||k==keys::RIGHT) s->key=k;
+                    else if(s->st.blinky_human) blinky_command(k,s->bdx,s->bdy);
+                });
+                // Basura sin teclas válidas: se descarta para no trabar el buffer
+                if(used==0 && s->have==sizeof(s->in)) used=s->have;
+                memmove(s->in,s->in+used,s->have-used); s->have-=used;
+            }
+        }
+        if(n<256) break;
+    }
+}
+
+// Escribe lo pendiente sin bloquear; un error cierra la sesión
+void Server::flush(Session& s){
+    size_t off=0;
+    while(off<s.out.size()){
+        ssize_t n=send(s.fd,s.out.data()+off,s.out.size()-off,MSG_DONTWAIT|MSG_NOSIGNAL);
+        if(n>0){ off+=(size_t)n; continue; }
+        if(n<0 && errno==EINTR) continue;
+        if(n<0 && (errno==EAGAIN||errno==EWOULDBLOCK)) break;
+        s.done=true; s.out.clear(); return;
+    }
+    s.bytes_out+=off;
+    s.out.erase(0,off);
+}
+
+void Server::tick_session(Session& s){
+    if(s.done) return;
+    if(s.quit || game_finished(s.st)){
+        char msg[96];
+        int n=snprintf(msg,sizeof msg,"\x1b[0m\r\n%s | Puntos: %d\r\n",s.quit? "Fin" : "Partida terminada",s.st.score);
+        s.out.append(msg,(size_t)n);
+        flush(s);
+        s.done=true;
+        return;
+    }
+    apply_tick_input(s.st,s.key,s.bdx,s.bdy);
+    sim_tick_rest(s.st,opt.mode);
+    s.key=keys::NONE; s.bdx=s.bdy=0;
+    s.ticks++;
+    // Cliente que no lee: no se dibuja hasta que baje el pendiente y el
+    // siguiente frame va completo (el diff supone que vio el anterior)
+    if(s.out.size()>=opt.out_cap){ s.frames_skipped++; s.fr.invalidate(); }
+    else {
+        s.fr.draw(s.st);
+        if(s.out.empty()) s.out.swap(s.fr.out);
+        else s.out.append(s.fr.out);
+    }
+    flush(s);
+    s.lat_ns=now_ns()-round_t0;
+}
+
+// Tareas propias del frente; vacía la cola, roba del fondo de las otras
+void Server::work(int self){
+    int w=(int)queues.size(), t;
+    size_t n=sessions.size(), chunk=(size_t)opt.chunk;
+    auto run=[&](int task){
+        size_t b=(size_t)task*chunk, e=std::min(n,b+chunk);
+        for(size_t i=b;i<e;i++) tick_session(*sessions[i]);
+    };
+    while(queues[(size_t)self].pop(t)) run(t);
+    for(int k=1;k<w;k++){
+        TaskQueue& v=queues[(size_t)((self+k)%w)];
+        while(v.steal(t)){ stolen.fetch_add(1,std::memory_order_relaxed); run(t); }
+    }
+}
+
+void Server::reap(){
+    size_t j=0;
+    for(size_t i=0;i<sessions.size();i++){
+        Session& s=*sessions[i];
+        if(s.done){
+            ::close(s.fd);              // epoll lo saca solo
+            finished++;
+            continue;
+        }
+        if(j!=i) sessions[j]=std::move(sessions[i]);
+        j++;
+    }
+    sessions.resize(j);
+}
+
+void Server::round(){
+    round_t0=now_ns();
+    poll_io();
+    size_t n=sessions.size();
+    int w=(int)queues.size();
+    int tasks=(int)((n+(size_t)opt.chunk-1)/(size_t)opt.chunk);
+    // Tramos contiguos por worker; el robo corrige el desbalance
+    for(int k=0;k<w;k++){
+        TaskQueue& q=queues[(size_t)k];
+        int b=(int)((int64_t)tasks*k/w), e=(int)((int64_t)tasks*(k+1)/w);
+        q.q.resize((size_t)(e-b));
+        for(int i=b;i<e;i++) q.q[(size_t)(i-b)]=i;
+        q.head=0; q.tail=q.q.size();
+    }
+    if(!th.empty()) barrier.arrive_and_wait();     // A
+    work(0);
+    if(!th.empty()) barrier.arrive_and_wait();     // B
+
+    for(auto& s: sessions){
+        if(s->lat_ns){ latency.add(s->lat_ns); s->lat_ns=0; session_ticks++; }
+    }
+    tasks_stolen=stolen.load(std::memory_order_relaxed);
+    reap();
+    rounds++;
+    round_ns=now_ns()-round_t0;
+}
+
+void Server::run(const volatile sig_atomic_t* stop,int report_every_s){
+    TickClock clock(TICK_US);
+    uint64_t t_rep=now_ns(), ticks_rep=session_ticks;
+    while(!*stop){
+        clock.wait();
+        round();
+        uint64_t now=now_ns();
+        if(report_every_s>0 && now-t_rep>=(uint64_t)report_every_s*1000000000ull){
+            TickLatency::Summary l=latency.summary();
+            uint64_t skipped=0; for(auto& s: sessions) skipped+=s->frames_skipped;
+            fprintf(stderr,"[servidor] %zu sesiones | %.0f ticks/s | tick->frame p50 %.0f us p99 %.0f us | "
+                           "ronda %.2f ms | robadas %llu | frames salteados %llu | atrasos %llu\n",
+                    sessions.size(),(session_ticks-ticks_rep)*1e9/(now-t_rep),l.p50_us,l.p99_us,round_ns/1e6,
+                    (unsigned long long)tasks_stolen,(unsigned long long)skipped,(unsigned long long)clock.overruns);
+            latency.clear();
+            t_rep=now; ticks_rep=session_ticks;
+        }
+    }
+}
+
+int attach(const std::string& path){
+    sockaddr_un a; std::string err;
+    int fd=socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+    if(fd<0 || !unix_addr(path,a,&err) || connect(fd,(sockaddr*)&a,sizeof a)!=0){
+        fprintf(stderr,"no se pudo conectar a %s: %s\n",path.c_str(),err.empty()? strerror(errno) : err.c_str());
+        if(fd>=0) ::close(fd);
+        return 1;
+    }
+    {
+        keys::RawGuard rg;
+        char buf[16384];
+        // Puro relevo: las teclas van tal cual, los frames salen tal cual
+        while(true){
+            pollfd p[2]={{STDIN_FILENO,POLLIN,0},{fd,POLLIN,0}};
+            if(poll(p,2,-1)<0){ if(errno==EINTR) continue; break; }
+            if(p[0].revents&POLLIN){
+                ssize_t n=::read(STDIN_FILENO,buf,sizeof buf);
+                if(n<=0 && !(n<0 && (errno==EINTR||errno==EAGAIN))) break;
+                if(n>0 && send(fd,buf,(size_t)n,MSG_NOSIGNAL)<0) break;
+            }
+            if(p[1].revents){
+                ssize_t n=recv(fd,buf,sizeof buf,0);
+                if(n<=0) break;
+                term::write_all(STDOUT_FILENO,buf,(size_t)n);
+            }
+        }
+    }
+    ::close(fd);
+    printf("\n");
+    return 0;
+}
+
+} // namespace server
@@ -0,0 +1,107 @@
+#pragma once
+// Servidor de muchas partidas: sesiones por socket Unix, un pool chico de hilos
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <csignal>
+#include <pthread.h>
+#include "game.hpp"
+#include "render.hpp"
+#include "engine.hpp"
+
+// ============================================================================
+// Servidor multi-sesión
+// ============================================================================
+// Cada conexión (socket Unix en modo stream, p. ej. una terminal en modo raw
+// con --attach) es una partida: un SimState, su propio FrameRenderer que deja
+// el frame en memoria y un buffer de salida. No hay hilos por partida: en cada
+// ronda (un período de TICK_US) el hilo principal lee la entrada de todos con
+// epoll, reparte las sesiones en tramos a las colas de los workers y cada
+// worker hace tick + frame + write no bloqueante de sus tramos; el que vacía
+// su cola le roba tramos a los demás. Si un cliente no lee, su buffer crece
+// hasta out_cap y después se saltean frames (el siguiente que sale va completo).
+namespace server {
+
+struct Options {
+    int workers=0;              // 0 = núcleos disponibles (el hilo principal cuenta como uno)
+    GameMode mode=MODE_1;
+    int ghosts=DEFAULT_GHOSTS;
+    int cols=80, rows=24;       // tamaño de la pantalla de cada sesión
+    size_t out_cap=64*1024;     // bytes pendientes por sesión antes de saltear frames
+    int chunk=16;               // sesiones por tarea del pool
+};
+
+struct Session {
+    int fd=-1;
+    SimState st;
+    FrameRenderer fr;
+    std::string out;                    // pendiente de escribir
+    unsigned char in[64]; size_t have=0;
+    keys::Key key=keys::NONE;           // última flecha desde la ronda anterior
+    int bdx=0, bdy=0;                   // último WASD (Blinky, Modo 3)
+    bool quit=false, done=false;        // done: partida terminada o cliente caído
+    uint64_t lat_ns=0;                  // inicio de la ronda -> frame escrito
+    uint64_t ticks=0, frames_skipped=0, bytes_out=0;
+
+    Session(std::shared_ptr<const Maze> m,int ghosts): st(std::move(m),ghosts) {}
+};
+
+// Cola de tareas de un worker: el dueño saca del frente, los ladrones del fondo
+struct TaskQueue {
+    pthread_mutex_t m=PTHREAD_MUTEX_INITIALIZER;
+    std::vector<int> q;
+    size_t head=0, tail=0;
+    bool pop(int& t){ pthread_mutex_lock(&m); bool ok=head<tail; if(ok) t=q[head++]; pthread_mutex_unlock(&m); return ok; }
+    bool steal(int& t){ pthread_mutex_lock(&m); bool ok=head<tail; if(ok) t=q[--tail]; pthread_mutex_unlock(&m); return ok; }
+};
+
+struct Server {
+    Options opt;
+    std::shared_ptr<const Maze> maze;
+    std::vector<std::unique_ptr<Session>> sessions;
+    int listen_fd=-1, ep=-1;
+    std::string path;
+
+    // Estadísticas
+    uint64_t rounds=0, session_ticks=0, accepted=0, finished=0;
+    uint64_t tasks_stolen=0;
+    TickLatency latency;                // una muestra por sesión y ronda
+    uint64_t round_ns=0;                // trabajo de la última ronda (sin el sleep)
+
+    explicit Server(const Options& o,std::shared_ptr<const Maze> m=Maze::current());
+    ~Server();
+    Server(const Server&)=delete;
+    Server& operator=(const Server&)=delete;
+
+    bool listen(const std::string& unix_path,std::string* err);
+    // Adopta una conexión ya abierta (el bench usa socketpair)
+    Session* add(int fd);
+    // Una ronda: entrada, tick de todas las sesiones en el pool y limpieza
+    void round();
+    // Rondas cada TICK_US hasta que *stop deje de ser 0 (lo pone un handler de señal)
+    void run(const volatile sig_atomic_t* stop,int report_every_s=0);
+    int workers() const { return (int)queues.size(); }
+
+    // Pool (interno)
+    std::vector<TaskQueue> queues;
+    std::vector<pthread_t> th;
+    tsync::PhaseBarrier barrier{1};
+    std::atomic<uint64_t> stolen{0};
+    struct WorkerArg { Server* srv; int self; };
+    std::vector<WorkerArg> args;
+    uint64_t round_t0=0;
+    bool quit=false;
+
+    void work(int self);
+    void tick_session(Session& s);
+    void flush(Session& s);
+    void poll_io();
+    void reap();
+};
+
+// Se conecta a un servidor (--serve) y hace de terminal: teclas al socket, frames a stdout
+int attach(const std::string& path);
+
+} // namespace server
@@ -0,0 +1,157 @@
+#pragma once
+// Terminal (ANSI), teclado en modo raw y reloj monotónico
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+
+inline uint64_t now_ns(){ timespec t; clock_gettime(CLOCK_MONOTONIC,&t); return (uint64_t)t.tv_sec*1000000000ull+(uint64_t)t.tv_nsec; }
+
+// ============================================================================
+// Terminal UI
+// ============================================================================
+namespace term {
+// Tamaño de terminal cacheado: solo se vuelve a consultar (ioctl) tras SIGWINCH
+inline volatile sig_atomic_t size_dirty=1;
+inline int cached_cols=80, cached_rows=24;
+inline void on_winch(int){ size_dirty=1; }
+inline void install_winch(){
+    struct sigaction sa{}; sa.sa_handler=on_winch; sigemptyset(&sa.sa_mask); sa.sa_flags=SA_RESTART;
+    sigaction(SIGWINCH,&sa,nullptr);
+}
+inline bool refresh_size(){
+    if(!size_dirty) return false;
+    size_dirty=0;
+    winsize w{};
+    if(ioctl(STDOUT_FILENO,TIOCGWINSZ,&w)==0){
+        if(w.ws_col>0) cached_cols=w.ws_col;
+        if(w.ws_row>0) cached_rows=w.ws_row;
+    }
+    return true;
+}
+inline int width(){ refresh_size(); return cached_cols; }
+inline int height(){ refresh_size(); return cached_rows; }
+
+// Escribe todo el buffer con write() (reintenta escrituras parciales / EINTR)
+inline void write_all(int fd,const char* p,size_t n){
+    while(n>0){
+        ssize_t w=::write(fd,p,n);
+        if(w<0){ if(errno==EINTR) continue; return; }
+        p+=w; n-=(size_t)w;
+    }
+}
+
+inline void clear(){ std::cout << "\x1b[2J\x1b[H"; }
+inline std::string bold(const std::string& s){ return "\x1b[1m"+s+"\x1b[0m"; }
+inline std::string dim (const std::string& s){ return "\x1b[2m"+s+"\x1b[0m"; }
+inline std::string inv (const std::string& s){ return "\x1b[7m"+s+"\x1b[0m"; }
+inline void println_center(const std::string& s){ int W=width(); int pad=(W-(int)s.size())/2; if(pad<0) pad=0; std::cout<<std::string(pad,' ')<<s<<"\n"; }
+}
+// ============================================================================
+// Teclado (raw no bloqueante)
+// ============================================================================
+namespace keys {
+enum Key { NONE=0, ENTER, UP, DOWN, LEFT, RIGHT, QUIT, W, A, S, D, NUM1, NUM2, NUM3, NUM4 };
+
+struct RawGuard {
+    termios old{}; bool active=false;
+    explicit RawGuard(bool enable=true){
+        if(!enable || !isatty(STDIN_FILENO)) return;
+        tcgetattr(STDIN_FILENO,&old);
+        termios raw=old;
+        raw.c_lflag &= ~(ICANON|ECHO);
+        raw.c_cc[VMIN]=0; raw.c_cc[VTIME]=1;
+        tcsetattr(STDIN_FILENO,TCSAFLUSH,&raw);
+        active=true;
+    }
+    ~RawGuard(){ if(active) tcsetattr(STDIN_FILENO,TCSAFLUSH,&old); }
+};
+
+inline Key decode(const unsigned char* buf,ssize_t n){
+    if(n<=0) return NONE;
+    if(n==1){
+        unsigned char c=buf[0];
+        if(c=='\n'||c=='\r') return ENTER;
+        if(c=='q'||c=='Q')   return QUIT;
+        if(c=='w'||c=='W')   return W;
+        if(c=='a'||c=='A')   return A;
+        if(c=='s'||c=='S')   return S;
+        if(c=='d'||c=='D')   return D;
+        if(c=='1') return NUM1;
+        if(c=='2') return NUM2;
+        if(c=='3') return NUM3;
+        if(c=='4') return NUM4;
+        return NONE;
+    }
+    if(n==3 && buf[0]==0x1b && buf[1]=='['){
+        if(buf[2]=='A') return UP;
+        if(buf[2]=='B') return DOWN;
+        if(buf[2]=='C') return RIGHT;
+        if(buf[2]=='D') return LEFT;
+    }
+    return NONE;
+}
+
+// Parte un bloque leído en teclas (varias por read() si se tipeó rápido).
+// Devuelve cuántos bytes consumió: una secuencia ESC incompleta al final se deja
+// para la próxima lectura.
+template<class F> inline size_t decode_all(const unsigned char* buf,size_t n,F&& emit){
+    size_t i=0;
+    while(i<n){
+        if(buf[i]==0x1b){
+            if(i+1>=n || (buf[i+1]=='[' && i+2>=n)) break;       // incompleta
+            if(buf[i+1]=='['){
+                Key k=decode(buf+i,3);
+                if(k!=NONE) emit(k);
+                i+=3;
+            }else i+=1;                                         // ESC suelto
+            continue;
+        }
+        Key k=decode(buf+i,1);
+        if(k!=NONE) emit(k);
+        i++;
+    }
+    return i;
+}
+
+inline Key read(){
+    unsigned char buf[3]; ssize_t n=::read(STDIN_FILENO,buf,sizeof(buf));
+    return decode(buf,n);
+}
+
+// Sin esperar (ignora VTIME): NONE si no hay nada pendiente
+inline Key read_nowait(){
+    pollfd p{STDIN_FILENO,POLLIN,0};
+    if(poll(&p,1,0)<=0 || !(p.revents&POLLIN)) return NONE;
+    return read();
+}
+}
+
+// Helpers para alternar modo raw/cooked cuando pedimos iniciales
+namespace tty_mode {
+inline bool saved=false;
+inline termios saved_t{};
+inline void init(){
+    if(!isatty(STDIN_FILENO)) return;
+    if(!saved){ tcgetattr(STDIN_FILENO,&saved_t); saved=true; }
+}
+inline void to_cooked(){
+    if(!saved) init();
+    if(!isatty(STDIN_FILENO)) return;
+    tcsetattr(STDIN_FILENO,TCSAFLUSH,&saved_t);
+}
+inline void to_raw(){
+    if(!saved) init();
+    if(!isatty(STDIN_FILENO)) return;
+    termios raw=saved_t;
+    raw.c_lflag &= ~(ICANON|ECHO);
+    raw.c_cc[VMIN]=0; raw.c_cc[VTIME]=1;
+    tcsetattr(STDIN_FILENO,TCSAFLUSH,&raw);
+}
+}
@@ -0,0 +1,127 @@
+#include "vecenv.hpp"
+#include <cstring>
+#include <unistd.h>
+#include "replay.hpp"
+
+namespace vecenv {
+
+namespace {
+void* chunk_worker(void* arg){
+    VecEnv::Chunk* c=(VecEnv::Chunk*)arg;
+    VecEnv* v=c->owner;
+    while(true){
+        v->barrier.arrive_and_wait();       // A: hay paso nuevo (o salir)
+        if(v->quit) break;
+        v->run_chunk(*c);
+        v->barrier.arrive_and_wait();       // B
+    }
+    return nullptr;
+}
+inline uint64_t mix(uint64_t z){
+    z+=0x9E3779B97F4A7C15ull;
+    z=(z^(z>>30))*0xBF58476D1CE4E5B9ull; z=(z^(z>>27))*0x94D049BB133111EBull;
+    return z^(z>>31);
+}
+}
+
+VecEnv::VecEnv(const Options& o,std::shared_ptr<const Maze> maze): opt(o), proto(std::move(maze),std::max(o.ghosts,0)){
+    if(opt.n<1) opt.n=1;
+    proto.blinky_human=(opt.mode==MODE_3);
+    size_t n=(size_t)opt.n;
+    envs.assign(n,proto);
+    seed.assign(n,0); ep_ticks.assign(n,0);
+    plane_words= opt.planes? proto.dots.w.size()+proto.pellets.w.size() : 0;
+    planes.assign(n*plane_words,0);
+    ent_stride=ENT_FIXED+3*proto.gh.n;
+    ent.assign(n*(size_t)ent_stride,0);
+    reward.assign(n,0); done.assign(n,RUNNING); final_score.assign(n,0);
+
+    int t=opt.threads>0? opt.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    t=std::max(1,std::min(t,opt.n));
+    opt.threads=t;
+    chunks.resize((size_t)t);
+    for(int k=0;k<t;k++) chunks[(size_t)k]=Chunk{this,(int)((int64_t)opt.n*k/t),(int)((int64_t)opt.n*(k+1)/t)};
+    barrier.init(t);
+    th.resize((size_t)t-1);
+    for(int k=1;k<t;k++) pthread_create(&th[(size_t)k-1],nullptr,chunk_worker,&chunks[(size_t)k]);
+    reset();
+}
+
+VecEnv::~VecEnv(){
+    quit=true;
+    if(!th.empty()) barrier.arrive_and_wait();
+    for(pthread_t& t: th) pthread_join(t,nullptr);
+}
+
+// Fila de observación del entorno i (planos vivos + entidades)
+void VecEnv::observe(int i){
+    const SimState& s=envs[(size_t)i];
+    if(plane_words){
+        uint64_t* p=&planes[(size_t)i*plane_words];
+        memcpy(p,s.dots.w.data(),s.dots.w.size()*8);
+        memcpy(p+s.dots.w.size(),s.pellets.w.data(),s.pellets.w.size()*8);
+    }
+    int16_t* e=&ent[(size_t)i*ent_stride];
+    e[E_PX]=(int16_t)s.px; e[E_PY]=(int16_t)s.py; e[E_PDX]=(int16_t)s.pdx; e[E_PDY]=(int16_t)s.pdy;
+    e[E_LIVES]=(int16_t)s.lives; e[E_POWER]=(int16_t)(s.power? s.powerTimer : 0);
+    int16_t* g=e+ENT_FIXED;
+    for(int k=0;k<s.gh.n;k++){ g[3*k]=s.gh.x[k]; g[3*k+1]=s.gh.y[k]; g[3*k+2]=s.gh.in_house[k]; }
+}
+
+void VecEnv::reset_one(int i,uint64_t sd){
+    SimState& s=envs[(size_t)i];
+    s=proto;
+    seed[(size_t)i]=sd;
+    // La simulación es determinista: la semilla solo elige cuántos ticks sin
+    // entrada corren antes de la primera acción (episodios que no arrancan igual)
+    int noop= opt.noop_max>0? (int)(mix(sd)%(uint64_t)opt.noop_max) : 0;
+    for(int k=0;k<noop && !game_finished(s);k++){ apply_tick_input(s,keys::NONE,0,0); sim_tick_rest(s,opt.mode); }
+    ep_ticks[(size_t)i]=0;
+}
+
+void VecEnv::run_chunk(const Chunk& c){
+    if(resetting){
+        for(int i=c.begin;i<c.end;i++){
+            reset_one(i,cur_seeds? cur_seeds[i] : (uint64_t)i);
+            reward[(size_t)i]=0; done[(size_t)i]=RUNNING; final_score[(size_t)i]=0;
+            observe(i);
+        }
+        return;
+    }
+    for(int i=c.begin;i<c.end;i++){
+        SimState& s=envs[(size_t)i];
+        keys::Key k; int bdx,bdy;
+        replay::decode(cur_actions[i],k,bdx,bdy);
+        int before=s.score;
+        apply_tick_input(s,k,bdx,bdy);
+        sim_tick_rest(s,opt.mode);
+        int32_t& t=ep_ticks[(size_t)i];
+        t++;
+        reward[(size_t)i]=s.score-before;
+        uint8_t d= game_finished(s)? TERMINATED : (opt.max_ticks>0 && t>=opt.max_ticks)? TRUNCATED : RUNNING;
+        done[(size_t)i]=d;
+        if(d){ final_score[(size_t)i]=s.score; reset_one(i,seed[(size_t)i]+(uint64_t)opt.n); }
+        observe(i);
+    }
+}
+
+void VecEnv::dispatch(){
+    if(!th.empty()) barrier.arrive_and_wait();  // A
+    run_chunk(chunks[0]);
+    if(!th.empty()) barrier.arrive_and_wait();  // B
+}
+
+void VecEnv::reset(const uint64_t* seeds){
+    resetting=true; cur_seeds=seeds;
+    dispatch();
+    resetting=false; cur_seeds=nullptr;
+}
+
+void VecEnv::step(const uint8_t* actions){
+    cur_actions=actions;
+    dispatch();
+    for(uint8_t d: done) episodes+=d!=RUNNING;
+    steps+=(uint64_t)opt.n;
+}
+
+} // namespace vecenv
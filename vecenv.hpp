@@ -0,0 +1,82 @@
+#pragma once
+// Entornos vectorizados: N partidas independientes avanzando a la par (entrenamiento)
+#include <vector>
+#include <cstdint>
+#include <pthread.h>
+#include "game.hpp"
+#include "engine.hpp"
+
+// ============================================================================
+// Entornos vectorizados
+// ============================================================================
+// N SimState en un arreglo, sin hilos por partida ni render: step() aplica una
+// acción por entorno y corre el mismo tick que el juego (apply_tick_input +
+// sim_tick_rest), repartiendo los entornos en tramos contiguos entre un pool
+// fijo de hilos (el que llama hace el primer tramo). Las salidas son arreglos
+// contiguos indexados por entorno, reescritos en cada paso.
+//
+// Acción = el byte de entrada de los replays (replay::encode): bits 0-3 tecla de
+// Pac-Man, bits 4-6 dirección de Blinky (solo cuenta en Modo 3). Así un paso
+// con una acción es exactamente un tick de una partida con esa entrada.
+namespace vecenv {
+
+struct Options {
+    int n=64;                   // entornos
+    int ghosts=DEFAULT_GHOSTS;
+    GameMode mode=MODE_1;
+    int threads=0;              // 0 = núcleos disponibles (el llamador cuenta como uno)
+    int max_ticks=5000;         // corte por tiempo (done=TRUNCATED); 0 = sin corte
+    int noop_max=0;             // ticks sin entrada al inicio, 0..noop_max-1 según la semilla
+    bool planes=true;           // observar fichas/power (si no, solo entidades)
+};
+
+enum Done : uint8_t { RUNNING=0, TERMINATED=1, TRUNCATED=2 };
+
+// Campos fijos de la fila de entidades; detrás, (x, y, en_casa) por fantasma
+enum Ent { E_PX=0, E_PY, E_PDX, E_PDY, E_LIVES, E_POWER, ENT_FIXED };
+
+struct VecEnv {
+    Options opt;
+    std::vector<SimState> envs;
+    std::vector<uint64_t> seed;         // semilla del episodio en curso
+    std::vector<int32_t> ep_ticks;      // ticks del episodio en curso
+
+    // Observaciones y resultados del último paso (fila i = entorno i)
+    size_t plane_words=0;               // palabras de 64 bits por entorno (fichas y luego power)
+    std::vector<uint64_t> planes;       // n * plane_words
+    int ent_stride=0;                   // ENT_FIXED + 3*fantasmas
+    std::vector<int16_t> ent;           // n * ent_stride
+    std::vector<int32_t> reward;        // puntos ganados en el paso (fichas, power, fantasmas)
+    std::vector<uint8_t> done;          // Done; el entorno ya arrancó el episodio siguiente
+    std::vector<int32_t> final_score;   // puntaje del episodio que terminó (si done)
+    uint64_t steps=0, episodes=0;
+
+    explicit VecEnv(const Options& o,std::shared_ptr<const Maze> maze=Maze::current());
+    ~VecEnv();
+    VecEnv(const VecEnv&)=delete;
+    VecEnv& operator=(const VecEnv&)=delete;
+
+    int size() const { return opt.n; }
+    // Reinicia todos los entornos (seeds: n semillas, o nullptr = 0..n-1)
+    void reset(const uint64_t* seeds=nullptr);
+    // Un tick en todos los entornos (actions: n bytes). Los que terminan se
+    // reinician con la semilla + n y done/final_score lo indican.
+    void step(const uint8_t* actions);
+
+    // Pool (interno)
+    SimState proto;                     // estado inicial: reset = asignación sin allocs
+    const uint8_t* cur_actions=nullptr;
+    bool resetting=false, quit=false;
+    const uint64_t* cur_seeds=nullptr;
+    std::vector<pthread_t> th;
+    struct Chunk { VecEnv* owner; int begin, end; };
+    std::vector<Chunk> chunks;
+    tsync::PhaseBarrier barrier{1};
+
+    void run_chunk(const Chunk& c);
+    void reset_one(int i,uint64_t s);
+    void observe(int i);
+    void dispatch();
+};
+
+} // namespace vecenv